@@ -8,13 +8,24 @@
       ],
       "sources": [
         "src/binding.cc",
+        "src/cancellation.cc",
         "src/conversions.cc",
+        "src/document.cc",
         "src/language.cc",
+        "src/language_index.cc",
         "src/logger.cc",
         "src/lookaheaditerator.cc",
         "src/node.cc",
+        "src/node_cache.cc",
+        "src/parse_cache.cc",
+        "src/parse_pool.cc",
+        "src/parse_scheduler.cc",
+        "src/parse_stats.cc",
         "src/parser.cc",
         "src/query.cc",
+        "src/source_file.cc",
+        "src/text_diff.cc",
+        "src/text_input.cc",
         "src/tree.cc",
         "src/tree_cursor.cc",
       ],
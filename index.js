@@ -2,7 +2,7 @@ const binding = typeof process.versions.bun === "string" ?
     // Statically analyzable enough for `bun build --compile` to embed the tree-sitter.node napi addon
     require(`./prebuilds/${process.platform}-${process.arch}/tree-sitter.node`) :
     require('node-gyp-build')(__dirname);
-const {Query, Parser, NodeMethods, Tree, TreeCursor, LookaheadIterator} = binding;
+const {Query, Parser, ParseCache, ParseScheduler, Document, LogBuffer, NodeMethods, Tree, TreeCursor, LookaheadIterator} = binding;
 
 const util = require('util');
 
@@ -10,7 +10,7 @@ const util = require('util');
  * Tree
  */
 
-const {rootNode, rootNodeWithOffset, edit} = Tree.prototype;
+const {rootNode, rootNodeWithOffset, edit, editMany, copy} = Tree.prototype;
 
 Object.defineProperty(Tree.prototype, 'rootNode', {
   get() {
@@ -39,7 +39,7 @@ Tree.prototype.rootNodeWithOffset = function(offset_bytes, offset_extent) {
 
 Tree.prototype.edit = function(arg) {
   if (this instanceof Tree && edit) {
-    edit.call(
+    this[editCountSymbol] = edit.call(
       this,
       arg.startPosition.row, arg.startPosition.column,
       arg.oldEndPosition.row, arg.oldEndPosition.column,
@@ -51,20 +51,158 @@ Tree.prototype.edit = function(arg) {
   }
 };
 
+Tree.prototype.editFromText = function(oldText, newText) {
+  const result = this._editFromText(oldText, newText);
+  this[editCountSymbol] = (this[editCountSymbol] | 0) + 1
+  return result
+};
+
+const EDIT_FIELD_COUNT = 9;
+
+Tree.prototype.editMany = function(edits) {
+  const fields = new Uint32Array(edits.length * EDIT_FIELD_COUNT);
+  for (let i = 0, offset = 0; i < edits.length; i++, offset += EDIT_FIELD_COUNT) {
+    const {startIndex, oldEndIndex, newEndIndex, startPosition, oldEndPosition, newEndPosition} = edits[i];
+    const values = [
+      startIndex, oldEndIndex, newEndIndex,
+      startPosition.row, startPosition.column,
+      oldEndPosition.row, oldEndPosition.column,
+      newEndPosition.row, newEndPosition.column,
+    ];
+    for (let j = 0; j < EDIT_FIELD_COUNT; j++) {
+      if (!Number.isInteger(values[j]) || values[j] < 0) {
+        throw new TypeError('Edit fields must be non-negative integers');
+      }
+      fields[offset + j] = values[j];
+    }
+  }
+  if (this instanceof Tree && editMany) {
+    this[editCountSymbol] = editMany.call(this, fields);
+  }
+  return this
+};
+
+Tree.prototype.copy = function() {
+  const tree = copy.call(this);
+  tree.input = this.input
+  tree.getText = this.getText
+  tree.language = this.language
+  return tree
+};
+
+// A handle can be sent to another thread with `postMessage`. The native tree
+// isn't serialized; only the text, when it's a string or a buffer, is cloned,
+// unless the native tree retains it and carries it along.
+Tree.prototype.toTransferable = function() {
+  const {input} = this;
+  const transferable = this._transfer();
+  if (this.getText !== getTextFromSource && (typeof input === 'string' || ArrayBuffer.isView(input))) {
+    transferable.input = input
+  }
+  return transferable
+};
+
+Tree.fromTransferable = function({handle, input, encoding}, language) {
+  if (!language.nodeSubclasses) {
+    initializeLanguageNodeClasses(language)
+  }
+  const tree = Tree._adopt(handle, language);
+  const source = tree._source();
+  if (source !== undefined) {
+    tree.input = source
+    tree.getText = getTextFromSource
+  } else if (typeof input === 'string') {
+    tree.input = input
+    tree.getText = getTextFromString
+  } else if (input !== undefined) {
+    tree.input = asBuffer(input)
+    tree.getText = getTextFromBufferFunction(encoding)
+  }
+  tree.language = language
+  return tree
+};
+
 Tree.prototype.walk = function() {
   return this.rootNode.walk()
 };
 
+Tree.prototype.setGeometryPrefetch = function(enabled) {
+  this._setGeometryPrefetch(enabled);
+  this[prefetchGeometrySymbol] = enabled;
+  return this
+};
+
+// The attributes `bulkAttributes` can fill, in the order of the native field
+// mask's bits.
+const BULK_ATTRIBUTES = [
+  'typeId', 'startIndex', 'endIndex', 'startRow', 'startColumn', 'endRow', 'endColumn', 'flags'
+];
+
+Tree.NodeFlags = Object.freeze({
+  NAMED: 1 << 0,
+  MISSING: 1 << 1,
+  EXTRA: 1 << 2,
+  HAS_ERROR: 1 << 3,
+  ERROR: 1 << 4,
+  HAS_CHANGES: 1 << 5,
+});
+
+Tree.prototype.bulkAttributes = function(nodes, output) {
+  const [handles, values] = marshalNodeList(nodes, this);
+  let fieldMask = 0;
+  const outputs = BULK_ATTRIBUTES.map((name, i) => {
+    if (output[name] === undefined) return undefined;
+    fieldMask |= 1 << i;
+    return output[name];
+  });
+  NodeMethods.bulkAttributes(this, handles, values, fieldMask, outputs);
+  return output
+};
+
+Tree.prototype.texts = function(nodes) {
+  if (this.getText !== getTextFromSource) {
+    return nodes.map(node => node.text)
+  }
+  const [handles, values] = marshalNodeList(nodes, this);
+  return NodeMethods.texts(this, handles, values)
+};
+
 /*
  * Node
  */
 
+// A node is its tree and a handle to a slot in the tree's native node table,
+// so every node object has the same shape and is passed to native methods
+// with a single write.
+const nodeHandleSymbol = Symbol('node.handle');
+
+// The objects of a tree's nodes, held as WeakRefs by handle in an array that
+// the native node table sweeps for collected nodes.
+const nodeObjectsSymbol = Symbol('tree.nodeObjects');
+
+// Trees with value nodes enabled don't keep a node table. Their nodes carry
+// the raw node fields instead, under a handle that marks them as values.
+const nodeValueSymbol = Symbol('node.value');
+const VALUE_NODE_HANDLE = 0xFFFFFFFF;
+const VALUE_NODE_FIELD_COUNT = 7;
+
+// When a tree prefetches geometry, new nodes carry their type id and position
+// as of the tree's edit count at the time, followed by that edit count. Any
+// later edit makes them fall back to native calls.
+const nodeGeometrySymbol = Symbol('node.geometry');
+const prefetchGeometrySymbol = Symbol('tree.prefetchGeometry');
+const editCountSymbol = Symbol('tree.editCount');
+const GEOMETRY_FIELD_COUNT = 7;
+
 class SyntaxNode {
-  constructor(tree) {
+  constructor(tree, handle, value = null, geometry = null) {
     Object.defineProperty(this, 'tree', {
       value: tree,
       enumerable: true
     });
+    this[nodeHandleSymbol] = handle;
+    this[nodeValueSymbol] = value;
+    this[nodeGeometrySymbol] = geometry;
   }
 
   [util.inspect.custom]() {
@@ -82,6 +220,8 @@ class SyntaxNode {
   }
 
   get typeId() {
+    const geometry = this[nodeGeometrySymbol];
+    if (geometry !== null) return geometry[0];
     marshalNode(this);
     return NodeMethods.typeId(this.tree);
   }
@@ -136,23 +276,31 @@ class SyntaxNode {
   }
 
   get startPosition() {
+    const geometry = currentGeometry(this);
+    if (geometry !== null) return {row: geometry[3], column: geometry[4]};
     marshalNode(this);
     NodeMethods.startPosition(this.tree);
     return unmarshalPoint();
   }
 
   get endPosition() {
+    const geometry = currentGeometry(this);
+    if (geometry !== null) return {row: geometry[5], column: geometry[6]};
     marshalNode(this);
     NodeMethods.endPosition(this.tree);
     return unmarshalPoint();
   }
 
   get startIndex() {
+    const geometry = currentGeometry(this);
+    if (geometry !== null) return geometry[1];
     marshalNode(this);
     return NodeMethods.startIndex(this.tree);
   }
 
   get endIndex() {
+    const geometry = currentGeometry(this);
+    if (geometry !== null) return geometry[2];
     marshalNode(this);
     return NodeMethods.endIndex(this.tree);
   }
@@ -355,8 +503,10 @@ class SyntaxNode {
  * Parser
  */
 
-const {parse, setLanguage} = Parser.prototype;
+const {parse, parseAsync, parseFile, parseFileAsync, parseSlice, setLanguage} = Parser.prototype;
+const {parseMany} = Parser;
 const languageSymbol = Symbol('parser.language');
+const sliceInputSymbol = Symbol('parser.sliceInput');
 
 Parser.prototype.setLanguage = function(language) {
   if (this instanceof Parser && setLanguage) {
@@ -373,12 +523,19 @@ Parser.prototype.getLanguage = function(_language) {
   return this[languageSymbol] || null;
 };
 
-Parser.prototype.parse = function(input, oldTree, {bufferSize, includedRanges, progressCallback}={}) {
+Parser.prototype.parse = function(input, oldTree, {
+  bufferSize, includedRanges, progressCallback, encoding, signal, cancellationFlag, deadline, valueNodes, prefetchGeometry,
+  retainSource
+}={}) {
   let getText, treeInput = input
   if (typeof input === 'string') {
-    const inputString = input;
-    input = (offset, _position) => inputString.slice(offset)
     getText = getTextFromString
+  } else if (input instanceof Uint8Array) {
+    treeInput = asBuffer(input)
+    getText = getTextFromBufferFunction(encoding)
+  } else if (Array.isArray(input)) {
+    treeInput = input.map(chunk => chunk instanceof Uint8Array ? asBuffer(chunk) : chunk)
+    getText = getTextFromChunksFunction(encoding)
   } else {
     getText = getTextFromFunction
   }
@@ -390,15 +547,244 @@ Parser.prototype.parse = function(input, oldTree, {bufferSize, includedRanges, p
       bufferSize,
       includedRanges,
       progressCallback,
+      encoding,
+      flagForSignal(signal, cancellationFlag),
+      deadline,
+      Boolean(retainSource),
     )
     : undefined;
 
   if (tree) {
     tree.input = treeInput
-    tree.getText = getText
+    tree.getText = retainSource && typeof input !== 'function' ? getTextFromSource : getText
     tree.language = this.getLanguage()
+    if (valueNodes) tree.setValueNodes(true)
+    if (prefetchGeometry) tree.setGeometryPrefetch(true)
+  }
+  return tree
+};
+
+Parser.prototype.parseAsync = async function(input, oldTree, {
+  includedRanges, encoding, signal, cancellationFlag, deadline, valueNodes, prefetchGeometry, retainSource
+}={}) {
+  const language = this.getLanguage();
+  const tree = this instanceof Parser && parseAsync
+    ? await withAbortSignal(signal, cancellationFlag, flag =>
+      parseAsync.call(this, input, oldTree, includedRanges, encoding, flag, deadline, Boolean(retainSource))
+    )
+    : undefined;
+
+  if (tree) {
+    if (typeof input === 'string') {
+      tree.input = input
+      tree.getText = getTextFromString
+    } else {
+      tree.input = asBuffer(input)
+      tree.getText = getTextFromBufferFunction(encoding)
+    }
+    if (retainSource) tree.getText = getTextFromSource
+    tree.language = language
+    if (valueNodes) tree.setValueNodes(true)
+    if (prefetchGeometry) tree.setGeometryPrefetch(true)
+  }
+  return tree
+};
+
+Parser.prototype.parseFile = function(path, oldTree, {
+  encoding = 'utf8', mmap = false, signal, cancellationFlag, deadline, valueNodes, prefetchGeometry
+}={}) {
+  const tree = this instanceof Parser && parseFile
+    ? parseFile.call(this, path, oldTree, encoding, mmap, flagForSignal(signal, cancellationFlag), deadline)
+    : undefined;
+
+  if (tree) {
+    tree.input = tree._source()
+    tree.getText = getTextFromSource
+    tree.language = this.getLanguage()
+    if (valueNodes) tree.setValueNodes(true)
+    if (prefetchGeometry) tree.setGeometryPrefetch(true)
+  }
+  return tree
+};
+
+Parser.prototype.parseFileAsync = async function(path, oldTree, {
+  encoding = 'utf8', mmap = false, signal, cancellationFlag, deadline, valueNodes, prefetchGeometry
+}={}) {
+  const language = this.getLanguage();
+  const tree = this instanceof Parser && parseFileAsync
+    ? await withAbortSignal(signal, cancellationFlag, flag =>
+      parseFileAsync.call(this, path, oldTree, encoding, mmap, flag, deadline)
+    )
+    : undefined;
+
+  if (tree) {
+    tree.input = tree._source()
+    tree.getText = getTextFromSource
+    tree.language = language
+    if (valueNodes) tree.setValueNodes(true)
+    if (prefetchGeometry) tree.setGeometryPrefetch(true)
+  }
+  return tree
+};
+
+Parser.PENDING = Symbol('Parser.PENDING');
+
+Parser.prototype.parseSlice = function(input, oldTree, {budgetMicros = 5000, encoding}={}) {
+  const language = this.getLanguage();
+  const restart = this[sliceInputSymbol] !== input;
+  this[sliceInputSymbol] = input;
+  const tree = this instanceof Parser && parseSlice
+    ? parseSlice.call(this, input, oldTree, budgetMicros, encoding, restart)
+    : undefined;
+
+  if (tree === undefined) {
+    return Parser.PENDING;
+  }
+  this[sliceInputSymbol] = undefined;
+  if (tree) {
+    if (typeof input === 'string') {
+      tree.input = input
+      tree.getText = getTextFromString
+    } else {
+      tree.input = asBuffer(input)
+      tree.getText = getTextFromBufferFunction(encoding)
+    }
+    tree.language = language
+  }
+  return tree
+};
+
+// A synchronous parse blocks the event loop, so an AbortSignal can't fire
+// while it runs. Only a signal that has already been aborted matters.
+function flagForSignal(signal, cancellationFlag) {
+  if (cancellationFlag || !signal || !signal.aborted) return cancellationFlag;
+  return new Int32Array([1]);
+}
+
+// Mirror an AbortSignal into a shared flag that a background parse can check
+// without calling back into JavaScript.
+async function withAbortSignal(signal, cancellationFlag, run) {
+  if (cancellationFlag || !signal) return run(cancellationFlag);
+  const flag = new Int32Array(new SharedArrayBuffer(4));
+  const onAbort = () => Atomics.store(flag, 0, 1);
+  if (signal.aborted) {
+    onAbort();
+  } else {
+    signal.addEventListener('abort', onAbort, {once: true});
+  }
+  try {
+    return await run(flag);
+  } finally {
+    signal.removeEventListener('abort', onAbort);
+  }
+}
+
+Parser.parseMany = async function(language, inputs, {concurrency, encoding}={}) {
+  if (!language.nodeSubclasses) {
+    initializeLanguageNodeClasses(language)
+  }
+  const trees = await parseMany.call(this, language, inputs, concurrency, encoding);
+  for (let i = 0; i < trees.length; i++) {
+    const tree = trees[i];
+    if (tree) {
+      const input = inputs[i];
+      if (typeof input === 'string') {
+        tree.input = input
+        tree.getText = getTextFromString
+      } else {
+        tree.input = asBuffer(input)
+        tree.getText = getTextFromBufferFunction(encoding)
+      }
+      tree.language = language
+    }
+  }
+  return trees
+};
+
+/*
+ * ParseScheduler
+ */
+
+const {_parse: scheduleParse} = ParseScheduler.prototype;
+
+ParseScheduler.prototype.parse = async function(language, input, {key, priority, oldTree, encoding}={}) {
+  if (!language.nodeSubclasses) {
+    initializeLanguageNodeClasses(language)
+  }
+  const tree = await scheduleParse.call(this, language, input, key, priority, oldTree, encoding);
+  // Callers whose jobs were superseded receive the same tree, but the caller
+  // whose input was actually parsed is always resolved first.
+  if (tree && tree.input === undefined) {
+    if (typeof input === 'string') {
+      tree.input = input
+      tree.getText = getTextFromString
+    } else {
+      tree.input = asBuffer(input)
+      tree.getText = getTextFromBufferFunction(encoding)
+    }
+    tree.language = language
+  }
+  return tree
+};
+
+/*
+ * LogBuffer
+ */
+
+const LOG_TYPES = ['parse', 'lex'];
+
+// Decode the drained records. The message's parameters are left unparsed.
+LogBuffer.prototype.drainMessages = function() {
+  const buffer = this.drain();
+  const result = [];
+  for (let offset = 0; offset < buffer.length;) {
+    const type = LOG_TYPES[buffer[offset]];
+    const length = buffer.readUInt16LE(offset + 2);
+    offset += 4;
+    result.push({type, message: buffer.toString('utf8', offset, offset + length)});
+    offset += length;
+  }
+  return result
+};
+
+/*
+ * Document
+ */
+
+const {_tree: documentTree, _layers: documentLayers, _applyTextEdits: applyTextEdits} = Document.prototype;
+
+Object.defineProperty(Document.prototype, 'tree', {
+  get() {
+    return setDocumentTreeInput(documentTree.call(this), this.getLanguage(), this.getEncoding())
+  }
+});
+
+Document.prototype.getLayers = function() {
+  const encoding = this.getEncoding();
+  const layers = documentLayers.call(this);
+  for (const layer of layers) {
+    setDocumentTreeInput(layer.tree, layer.language, encoding)
+  }
+  return layers
+};
+
+function setDocumentTreeInput(tree, language, encoding) {
+  if (tree.language === undefined) {
+    if (!language.nodeSubclasses) {
+      initializeLanguageNodeClasses(language)
+    }
+    // Node text is sliced natively, so the document's snapshot of the text is
+    // only copied out if the input itself is asked for.
+    Object.defineProperty(tree, 'input', {get: tree._source, configurable: true, enumerable: true})
+    tree.getText = getTextFromSource
+    tree.language = language
   }
   return tree
+}
+
+Document.prototype.applyTextEdits = function(edits) {
+  applyTextEdits.call(this, edits);
+  return this.tree
 };
 
 /*
@@ -646,14 +1032,19 @@ Query.prototype.matches = function(
     endIndex = 0,
     matchLimit = 0xFFFFFFFF,
     maxStartDepth = 0xFFFFFFFF,
-    timeoutMicros = 0
+    timeoutMicros = 0,
+    progressCallback = undefined,
+    signal = undefined,
+    cancellationFlag = undefined,
+    deadline = undefined,
   } = {}
 ) {
   marshalNode(node);
   const [returnedMatches, returnedNodes] = _matches.call(this, node.tree,
     startPosition.row, startPosition.column,
     endPosition.row, endPosition.column,
-    startIndex, endIndex, matchLimit, maxStartDepth, timeoutMicros
+    startIndex, endIndex, matchLimit, maxStartDepth, timeoutMicros, progressCallback,
+    flagForSignal(signal, cancellationFlag), deadline
   );
   const nodes = unmarshalNodes(returnedNodes, node.tree);
   const results = [];
@@ -698,12 +1089,16 @@ Query.prototype.captures = function(
     maxStartDepth = 0xFFFFFFFF,
     timeoutMicros = 0,
     progressCallback = undefined,
+    signal = undefined,
+    cancellationFlag = undefined,
+    deadline = undefined,
   } = {}
 ) {
   marshalNode(node);
   const [returnedMatches, returnedNodes] = _captures.call(this, node.tree,
     startPosition.row, startPosition.column, endPosition.row, endPosition.column,
-    startIndex, endIndex, matchLimit, maxStartDepth, timeoutMicros, progressCallback
+    startIndex, endIndex, matchLimit, maxStartDepth, timeoutMicros, progressCallback,
+    flagForSignal(signal, cancellationFlag), deadline
   );
   const nodes = unmarshalNodes(returnedNodes, node.tree);
   const results = [];
@@ -763,6 +1158,59 @@ function getTextFromString (node) {
   return this.input.substring(node.startIndex, node.endIndex);
 }
 
+function getTextFromBuffer (node) {
+  return this.input.toString('utf16le', node.startIndex * 2, node.endIndex * 2);
+}
+
+function getTextFromUTF8Buffer (node) {
+  return this.input.toString('utf8', node.startIndex, node.endIndex);
+}
+
+function getTextFromBufferFunction (encoding) {
+  return encoding === 'utf8' || encoding === 'utf-8' ? getTextFromUTF8Buffer : getTextFromBuffer;
+}
+
+// Node text is sliced from the chunks as bytes and decoded once, since a
+// character may be split across two chunks.
+function getTextFromChunksFunction (encoding) {
+  const utf8 = encoding === 'utf8' || encoding === 'utf-8';
+  const bytesPerCharacter = utf8 ? 1 : 2;
+  return function ({startIndex, endIndex}) {
+    const start = startIndex * bytesPerCharacter;
+    const end = endIndex * bytesPerCharacter;
+    const pieces = [];
+    let chunkStart = 0;
+    for (const chunk of this.input) {
+      if (chunkStart >= end) break;
+      const isString = typeof chunk === 'string';
+      const length = isString
+        ? (utf8 ? Buffer.byteLength(chunk) : chunk.length * 2)
+        : chunk.length;
+      const chunkEnd = chunkStart + length;
+      if (chunkEnd > start) {
+        const bytes = isString ? Buffer.from(chunk, utf8 ? 'utf8' : 'utf16le') : chunk;
+        pieces.push(bytes.subarray(Math.max(start, chunkStart) - chunkStart, Math.min(end, chunkEnd) - chunkStart));
+      }
+      chunkStart = chunkEnd;
+    }
+    return Buffer.concat(pieces).toString(utf8 ? 'utf8' : 'utf16le');
+  };
+}
+
+function asBuffer (bytes) {
+  return Buffer.isBuffer(bytes) ? bytes : Buffer.from(bytes.buffer, bytes.byteOffset, bytes.byteLength);
+}
+
+// Trees that retain their source slice node texts from it natively. Cursors
+// read the text of their current node.
+function getTextFromSource (node) {
+  if (!(node instanceof SyntaxNode)) {
+    node = node.currentNode
+  }
+  marshalNode(node);
+  return NodeMethods.text(this)
+}
+
 function getTextFromFunction ({startIndex, endIndex}) {
   const {input} = this
   let result = '';
@@ -776,76 +1224,127 @@ function getTextFromFunction ({startIndex, endIndex}) {
 
 const {pointTransferArray} = binding;
 
-const NODE_FIELD_COUNT = 6;
 const ERROR_TYPE_ID = 0xFFFF
 
-function getID(buffer, offset) {
-  const low  = BigInt(buffer[offset]);
-  const high = BigInt(buffer[offset + 1]);
-  return (high << 32n) + low;
-}
-
-function unmarshalNode(value, tree, offset = 0, cache = null) {
-  /* case 1: node from the tree cache */
+// The node that was transferred at `offset`. New node objects are indexed by
+// the native node table right away, or, when `handles` is given, by the
+// caller in one batch.
+function unmarshalNode(value, tree, offset = 0, handles = null) {
+  /* case 1: no node, or a node that has already been unmarshalled */
   if (typeof value === 'object') {
-    const node = value;
-    return node;
+    return value
+  }
+
+  const handle = binding.nodeTransferArray[offset];
+  if (handle === 0) {
+    return null
   }
 
-  /* case 2: node being transferred */
   const nodeTypeId = value;
   const NodeClass = nodeTypeId === ERROR_TYPE_ID
     ? SyntaxNode
     : tree.language.nodeSubclasses[nodeTypeId];
 
-  const {nodeTransferArray} = binding;
-  const id = getID(nodeTransferArray, offset)
-  if (id === 0n) {
-    return null
+  /* case 2: value node, which is never cached */
+  if (handle === VALUE_NODE_HANDLE) {
+    const start = offset * VALUE_NODE_FIELD_COUNT;
+    const fields = Array.from(
+      binding.valueNodeTransferArray.subarray(start, start + VALUE_NODE_FIELD_COUNT)
+    );
+    return new NodeClass(tree, handle, fields, unmarshalGeometry(tree, offset));
   }
 
-  let cachedResult;
-  if (cache && (cachedResult = cache.get(id)))
+  /* case 3: node whose object is still alive */
+  const objects = tree[nodeObjectsSymbol] || (tree[nodeObjectsSymbol] = tree._nodeObjects());
+  const ref = objects[handle];
+  const cachedResult = ref !== undefined ? ref.deref() : undefined;
+  if (cachedResult !== undefined)
     return cachedResult;
 
-  const result = new NodeClass(tree);
-  for (let i = 0; i < NODE_FIELD_COUNT; i++) {
-    result[i] = nodeTransferArray[offset + i];
-  }
+  /* case 4: new node */
+  const result = new NodeClass(tree, handle, null, unmarshalGeometry(tree, offset));
+  objects[handle] = new WeakRef(result);
 
-  if (cache)
-    cache.set(id, result);
+  if (handles)
+    handles.push(handle);
   else
-    tree._cacheNode(result);
+    tree._cacheNode(handle);
 
   return result;
 }
 
+function unmarshalGeometry(tree, offset) {
+  if (!tree[prefetchGeometrySymbol]) {
+    return null
+  }
+  const start = offset * GEOMETRY_FIELD_COUNT;
+  const geometry = Array.from(
+    binding.nodeGeometryTransferArray.subarray(start, start + GEOMETRY_FIELD_COUNT)
+  );
+  geometry.push(tree[editCountSymbol] | 0);
+  return geometry
+}
+
+// A node's prefetched position, unless its tree has been edited since.
+function currentGeometry(node) {
+  const geometry = node[nodeGeometrySymbol];
+  if (geometry !== null && geometry[GEOMETRY_FIELD_COUNT] === (node.tree[editCountSymbol] | 0)) {
+    return geometry
+  }
+  return null
+}
+
 function unmarshalNodes(nodes, tree) {
-  const cache = new Map();
+  const handles = [];
 
   let offset = 0;
   for (let i = 0, {length} = nodes; i < length; i++) {
-    const node = unmarshalNode(nodes[i], tree, offset, cache);
+    const node = unmarshalNode(nodes[i], tree, offset, handles);
     if (node !== nodes[i]) {
       nodes[i] = node;
-      offset += NODE_FIELD_COUNT
+      offset++
     }
   }
 
-  tree._cacheNodes(Array.from(cache.values()));
+  if (handles.length > 0) {
+    tree._cacheNodes(handles);
+  }
 
   return nodes;
 }
 
+// Nodes aren't updated when their tree is edited. The native node table
+// applies any edits a node hasn't seen the next time it's used.
 function marshalNode(node, offset = 0) {
   if (!(node.tree instanceof Tree)) {
     throw new TypeError("SyntaxNode must belong to a Tree")
   }
-  const { nodeTransferArray } = binding;
-  for (let i = 0; i < NODE_FIELD_COUNT; i++) {
-    nodeTransferArray[offset * NODE_FIELD_COUNT + i] = node[i];
+  const handle = node[nodeHandleSymbol];
+  binding.nodeTransferArray[offset] = handle;
+  if (handle === VALUE_NODE_HANDLE) {
+    binding.valueNodeTransferArray.set(node[nodeValueSymbol], offset * VALUE_NODE_FIELD_COUNT);
+  }
+}
+
+// Collect the handles of many nodes of one tree, and the fields of any value
+// nodes among them, for a single native call.
+function marshalNodeList(nodes, tree) {
+  const {length} = nodes;
+  const handles = new Uint32Array(length);
+  let values = null;
+  for (let i = 0; i < length; i++) {
+    const node = nodes[i];
+    if (!node || node.tree !== tree) {
+      throw new TypeError('Nodes must belong to the tree');
+    }
+    const handle = node[nodeHandleSymbol];
+    handles[i] = handle;
+    if (handle === VALUE_NODE_HANDLE) {
+      if (!values) values = new Uint32Array(length * VALUE_NODE_FIELD_COUNT);
+      values.set(node[nodeValueSymbol], i * VALUE_NODE_FIELD_COUNT);
+    }
   }
+  return [handles, values]
 }
 
 function marshalNodes(nodes) {
@@ -943,6 +1442,10 @@ function camelCase(name, upperCase) {
 }
 
 module.exports = Parser;
+module.exports.Document = Document;
+module.exports.LogBuffer = LogBuffer;
+module.exports.ParseCache = ParseCache;
+module.exports.ParseScheduler = ParseScheduler;
 module.exports.Query = Query;
 module.exports.Tree = Tree;
 module.exports.SyntaxNode = SyntaxNode;
@@ -1,6 +1,12 @@
+#include "./language_index.h"
+#include "./parse_pool.h"
 #include "tree_sitter/api.h"
 
+#include <algorithm>
+#include <memory>
 #include <napi.h>
+#include <thread>
+#include <unordered_map>
 
 #ifndef NODE_TREE_SITTER_ADDON_DATA_H_
 #define NODE_TREE_SITTER_ADDON_DATA_H_
@@ -15,18 +21,33 @@ public:
     ts_query_cursor_delete(ts_query_cursor);
   }
 
+  ParsePool &GetParsePool() {
+    if (!parse_pool) {
+      // Run's caller works alongside the pool, but submitted batches only
+      // run on the pool's own threads, so it needs at least one.
+      parse_pool = std::make_unique<ParsePool>(std::max(2U, std::thread::hardware_concurrency()) - 1);
+    }
+    return *parse_pool;
+  }
+
   // conversions
   uint32_t *point_transfer_buffer = nullptr;
+  std::unordered_map<const char *, Napi::Reference<Napi::String>> interned_names;
 
   // node
   uint32_t *transfer_buffer = nullptr;
   uint32_t transfer_buffer_length = 0;
+  uint32_t *value_transfer_buffer = nullptr;
+  uint32_t *geometry_transfer_buffer = nullptr;
   Napi::ObjectReference module_exports;
   TSTreeCursor scratch_cursor = {nullptr, nullptr, {0, 0}};
+  std::unordered_map<const TSLanguage *, std::unique_ptr<LanguageIndex>> language_indexes;
 
   // parser
   Napi::FunctionReference parser_constructor;
   Napi::FunctionReference string_slice;
+  // Shared by document layers and parseMany, and started on first use.
+  std::unique_ptr<ParsePool> parse_pool;
 
   // query
   TSQueryCursor *ts_query_cursor = nullptr;
@@ -37,6 +58,7 @@ public:
 
   // tree
   Napi::FunctionReference tree_constructor;
+  Napi::FunctionReference weak_ref_deref;
 
   // lookaheaditerator
   Napi::FunctionReference lookahead_iterator_constructor;
@@ -1,8 +1,12 @@
 #include "./addon_data.h"
 #include "./conversions.h"
+#include "./document.h"
 #include "./language.h"
+#include "./logger.h"
 #include "./lookaheaditerator.h"
 #include "./node.h"
+#include "./parse_cache.h"
+#include "./parse_scheduler.h"
 #include "./parser.h"
 #include "./query.h"
 #include "./tree.h"
@@ -19,10 +23,14 @@ Napi::Object InitAll(Napi::Env env, Napi::Object exports) {
   env.SetInstanceData(data);
 
   InitConversions(env, exports);
+  Document::Init(env, exports);
   node_methods::Init(env, exports);
   language_methods::Init(env, exports);
+  LogBuffer::Init(env, exports);
   LookaheadIterator::Init(env, exports);
   Parser::Init(env, exports);
+  ParseCache::Init(env, exports);
+  ParseScheduler::Init(env, exports);
   Query::Init(env, exports);
   Tree::Init(env, exports);
   TreeCursor::Init(env, exports);
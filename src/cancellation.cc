@@ -0,0 +1,69 @@
+#include "./cancellation.h"
+
+#include <napi.h>
+#include <uv.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+using namespace Napi;
+
+namespace node_tree_sitter {
+
+namespace {
+
+// The flag is written by other threads, or by other isolates through a
+// SharedArrayBuffer, so it has to be read atomically. Nothing else is
+// published through it, so no ordering is needed.
+int32_t load_flag(const int32_t *flag) {
+#ifdef _MSC_VER
+  return __iso_volatile_load32(reinterpret_cast<const volatile __int32 *>(flag));
+#else
+  return __atomic_load_n(flag, __ATOMIC_RELAXED);
+#endif
+}
+
+} // namespace
+
+Cancellation Cancellation::FromJS(const Napi::Value &flag, const Napi::Value &deadline) {
+  Cancellation result;
+
+  if (flag.IsTypedArray()) {
+    if (flag.As<TypedArray>().TypedArrayType() != napi_int32_array || flag.As<Int32Array>().ElementLength() == 0) {
+      throw TypeError::New(flag.Env(), "Cancellation flag must be a non-empty Int32Array");
+    }
+    // Keep the array alive for as long as the flag may be read, which can
+    // be on another thread for a background parse.
+    result.flag_ref_ = Napi::Persistent(flag.As<Object>());
+    result.flag_ = flag.As<Int32Array>().Data();
+  } else if (!flag.IsUndefined() && !flag.IsNull()) {
+    throw TypeError::New(flag.Env(), "Cancellation flag must be a non-empty Int32Array");
+  }
+
+  if (deadline.IsBigInt()) {
+    bool lossless;
+    result.deadline_ = deadline.As<BigInt>().Uint64Value(&lossless);
+  } else if (deadline.IsNumber()) {
+    result.deadline_ = static_cast<uint64_t>(deadline.As<Number>().DoubleValue());
+  } else if (!deadline.IsUndefined() && !deadline.IsNull()) {
+    throw TypeError::New(deadline.Env(), "Deadline must be a bigint or a number");
+  }
+
+  return result;
+}
+
+Cancellation Cancellation::AfterMicros(uint64_t micros) {
+  Cancellation result;
+  result.deadline_ = uv_hrtime() + micros * 1000;
+  return result;
+}
+
+bool Cancellation::IsCancelled() const {
+  if (flag_ != nullptr && load_flag(flag_) != 0) {
+    return true;
+  }
+  return deadline_ != 0 && uv_hrtime() >= deadline_;
+}
+
+} // namespace node_tree_sitter
@@ -0,0 +1,33 @@
+#ifndef NODE_TREE_SITTER_CANCELLATION_H_
+#define NODE_TREE_SITTER_CANCELLATION_H_
+
+#include <cstdint>
+#include <napi.h>
+
+namespace node_tree_sitter {
+
+// A cancellation flag and deadline that are checked entirely in native code,
+// so they can stop a parse or query on any thread without calling into JS.
+//
+// The flag is an Int32Array, usually backed by a SharedArrayBuffer, and is
+// set by storing a non-zero value in its first element. The deadline is an
+// absolute time in nanoseconds on the clock used by `process.hrtime.bigint()`.
+class Cancellation final {
+ public:
+  static Cancellation FromJS(const Napi::Value &flag, const Napi::Value &deadline);
+  static Cancellation AfterMicros(uint64_t micros);
+
+  Cancellation() = default;
+
+  bool IsEnabled() const { return flag_ != nullptr || deadline_ != 0; }
+  bool IsCancelled() const;
+
+ private:
+  Napi::ObjectReference flag_ref_;
+  const int32_t *flag_ = nullptr;
+  uint64_t deadline_ = 0;
+};
+
+} // namespace node_tree_sitter
+
+#endif // NODE_TREE_SITTER_CANCELLATION_H_
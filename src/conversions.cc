@@ -9,8 +9,6 @@ using namespace Napi;
 
 namespace node_tree_sitter {
 
-static const unsigned BYTES_PER_CHARACTER = 2;
-
 void InitConversions(Napi::Env env, Napi::Object exports) {
   auto *data = env.GetInstanceData<AddonData>();
 
@@ -20,22 +18,22 @@ void InitConversions(Napi::Env env, Napi::Object exports) {
   exports["pointTransferArray"] = js_point_transfer_buffer;
 }
 
-void TransferPoint(Napi::Env env, const TSPoint &point) {
+void TransferPoint(Napi::Env env, const TSPoint &point, TSInputEncoding encoding) {
   auto *data = env.GetInstanceData<AddonData>();
   data->point_transfer_buffer[0] = point.row;
-  data->point_transfer_buffer[1] = point.column / 2;
+  data->point_transfer_buffer[1] = point.column / BytesPerCharacter(encoding);
 }
 
-Napi::Object RangeToJS(Napi::Env env, const TSRange &range) {
+Napi::Object RangeToJS(Napi::Env env, const TSRange &range, TSInputEncoding encoding) {
   Object result = Object::New(env);
-  result.Set("startPosition", PointToJS(env, range.start_point));
-  result.Set("startIndex", ByteCountToJS(env, range.start_byte));
-  result.Set("endPosition", PointToJS(env, range.end_point));
-  result.Set("endIndex", ByteCountToJS(env, range.end_byte));
+  result.Set("startPosition", PointToJS(env, range.start_point, encoding));
+  result.Set("startIndex", ByteCountToJS(env, range.start_byte, encoding));
+  result.Set("endPosition", PointToJS(env, range.end_point, encoding));
+  result.Set("endIndex", ByteCountToJS(env, range.end_byte, encoding));
   return result;
 }
 
-Napi::Maybe<TSRange> RangeFromJS(const Napi::Value& arg) {
+Napi::Maybe<TSRange> RangeFromJS(const Napi::Value& arg, TSInputEncoding encoding) {
   Env env = arg.Env();
   if (!arg.IsObject()) {
     TypeError::New(env, "Range must be a {startPosition, endPosition, startIndex, endIndex} object").ThrowAsJavaScriptException();
@@ -52,7 +50,7 @@ Napi::Maybe<TSRange> RangeFromJS(const Napi::Value& arg) {
       TypeError::New(env, "Range must be a {startPosition, endPosition, startIndex, endIndex} object").ThrowAsJavaScriptException(); \
       return Napi::Nothing<TSRange>(); \
     } \
-    auto field = Convert(value); \
+    auto field = Convert(value, encoding); \
     if (field.IsJust()) { \
       result.field = field.Unwrap(); \
     } else { \
@@ -70,14 +68,14 @@ Napi::Maybe<TSRange> RangeFromJS(const Napi::Value& arg) {
   return Napi::Just(result);
 }
 
-Napi::Object PointToJS(Napi::Env env, const TSPoint &point) {
+Napi::Object PointToJS(Napi::Env env, const TSPoint &point, TSInputEncoding encoding) {
   Object result = Object::New(env);
   result["row"] = Number::New(env, point.row);
-  result["column"] = ByteCountToJS(env, point.column);
+  result["column"] = ByteCountToJS(env, point.column, encoding);
   return result;
 }
 
-Napi::Maybe<TSPoint> PointFromJS(const Napi::Value& arg) {
+Napi::Maybe<TSPoint> PointFromJS(const Napi::Value& arg, TSInputEncoding encoding) {
   Env env = arg.Env();
 
   if (!arg.IsObject()) {
@@ -112,7 +110,7 @@ Napi::Maybe<TSPoint> PointFromJS(const Napi::Value& arg) {
   if (!std::isfinite(js_column.DoubleValue())) {
     column = UINT32_MAX;
   } else if (js_column.IsNumber()) {
-    column = js_column.Uint32Value() * BYTES_PER_CHARACTER;
+    column = js_column.Uint32Value() * BytesPerCharacter(encoding);
   } else {
     TypeError::New(env, "Point.column must be a number").ThrowAsJavaScriptException();
     return Napi::Nothing<TSPoint>();
@@ -121,11 +119,23 @@ Napi::Maybe<TSPoint> PointFromJS(const Napi::Value& arg) {
   return Napi::Just<TSPoint>({row, column});
 }
 
-Napi::Number ByteCountToJS(Napi::Env env, uint32_t byte_count) {
-  return Number::New(env, byte_count / BYTES_PER_CHARACTER);
+Napi::Number ByteCountToJS(Napi::Env env, uint32_t byte_count, TSInputEncoding encoding) {
+  return Number::New(env, byte_count / BytesPerCharacter(encoding));
+}
+
+// Node type and field names point into their language's static tables, so
+// each one is converted to a JS string once and then reused, keyed by its
+// address.
+Napi::String NameToJS(Napi::Env env, const char *name) {
+  auto *data = env.GetInstanceData<AddonData>();
+  auto [entry, inserted] = data->interned_names.try_emplace(name);
+  if (inserted) {
+    entry->second = Napi::Persistent(String::New(env, name));
+  }
+  return entry->second.Value();
 }
 
-Napi::Maybe<uint32_t> ByteCountFromJS(const Napi::Value &arg) {
+Napi::Maybe<uint32_t> ByteCountFromJS(const Napi::Value &arg, TSInputEncoding encoding) {
   Napi::Env env = arg.Env();
 
   if (!arg.IsNumber()) {
@@ -134,7 +144,7 @@ Napi::Maybe<uint32_t> ByteCountFromJS(const Napi::Value &arg) {
   }
   auto result = arg.As<Number>();
 
-  return Napi::Just<uint32_t>(result.Uint32Value() * BYTES_PER_CHARACTER);
+  return Napi::Just<uint32_t>(result.Uint32Value() * BytesPerCharacter(encoding));
 }
 
 } // namespace node_tree_sitter
@@ -8,14 +8,21 @@
 
 namespace node_tree_sitter {
 
+// Indices and columns are exposed to JS in UTF-16 code units for UTF-16 input,
+// and in bytes for UTF-8 input.
+static inline uint32_t BytesPerCharacter(TSInputEncoding encoding) {
+  return encoding == TSInputEncodingUTF8 ? 1 : 2;
+}
+
 void InitConversions(Napi::Env env, Napi::Object exports);
-Napi::Object RangeToJS(Napi::Env env, const TSRange &);
-Napi::Object PointToJS(Napi::Env env, const TSPoint &);
-void TransferPoint(Napi::Env env, const TSPoint &);
-Napi::Number ByteCountToJS(Napi::Env env, uint32_t);
-Napi::Maybe<TSPoint> PointFromJS(const Napi::Value &);
-Napi::Maybe<uint32_t> ByteCountFromJS(const Napi::Value &);
-Napi::Maybe<TSRange> RangeFromJS(const Napi::Value&);
+Napi::Object RangeToJS(Napi::Env env, const TSRange &, TSInputEncoding);
+Napi::Object PointToJS(Napi::Env env, const TSPoint &, TSInputEncoding);
+void TransferPoint(Napi::Env env, const TSPoint &, TSInputEncoding);
+Napi::Number ByteCountToJS(Napi::Env env, uint32_t, TSInputEncoding);
+Napi::String NameToJS(Napi::Env env, const char *name);
+Napi::Maybe<TSPoint> PointFromJS(const Napi::Value &, TSInputEncoding);
+Napi::Maybe<uint32_t> ByteCountFromJS(const Napi::Value &, TSInputEncoding);
+Napi::Maybe<TSRange> RangeFromJS(const Napi::Value&, TSInputEncoding);
 
 } // namespace node_tree_sitter
 
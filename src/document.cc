@@ -0,0 +1,572 @@
+#include "./document.h"
+#include "./addon_data.h"
+#include "./conversions.h"
+#include "./language.h"
+#include "./query.h"
+#include "./text_input.h"
+#include "./tree.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <napi.h>
+#include <tuple>
+
+using namespace Napi;
+
+namespace node_tree_sitter {
+
+namespace {
+
+const size_t kMinimumGap = 64;
+
+// Injections inside injections are followed this many levels deep.
+const uint32_t kMaxInjectionDepth = 4;
+
+// A snapshot's edits are folded into a new base once there are this many, or
+// once they insert more text than the base holds.
+const size_t kMaxSnapshotEdits = 256;
+
+std::string text_from_js(const Napi::Value &value, TSInputEncoding encoding) {
+  std::string text;
+  if (value.IsString()) {
+    if (!StringFromJS(value, encoding, &text)) {
+      throw Error::New(value.Env(), "Failed to read the text");
+    }
+  } else if (IsByteArray(value)) {
+    auto bytes = value.As<Uint8Array>();
+    text.assign(reinterpret_cast<const char *>(bytes.Data()), bytes.ByteLength());
+  } else {
+    throw TypeError::New(value.Env(), "Text must be a string or a Buffer");
+  }
+  return text;
+}
+
+GapBuffer gap_buffer_from_js(const Napi::Value &text, const Napi::Value &js_encoding) {
+  TSInputEncoding encoding = EncodingFromJS(js_encoding, TSInputEncodingUTF16LE);
+  return GapBuffer(text_from_js(text, encoding), encoding);
+}
+
+} // namespace
+
+GapBuffer::GapBuffer(std::string text, TSInputEncoding encoding)
+  : data_(text.begin(), text.end()), gap_start_(text.size()), gap_end_(text.size()), encoding_(encoding) {
+  line_starts_.push_back(0);
+  size_t unit = BytesPerCharacter(encoding_);
+  for (size_t i = 0; i + unit <= text.size(); i += unit) {
+    if (IsNewline(&text[i])) {
+      line_starts_.push_back(i + unit);
+    }
+  }
+}
+
+bool GapBuffer::IsNewline(const char *data) const {
+  return encoding_ == TSInputEncodingUTF8 ? data[0] == '\n' : data[0] == '\n' && data[1] == 0;
+}
+
+void GapBuffer::MoveGap(size_t position) {
+  if (position < gap_start_) {
+    size_t count = gap_start_ - position;
+    std::memmove(&data_[gap_end_ - count], &data_[position], count);
+    gap_start_ -= count;
+    gap_end_ -= count;
+  } else if (position > gap_start_) {
+    size_t count = position - gap_start_;
+    std::memmove(&data_[gap_start_], &data_[gap_end_], count);
+    gap_start_ += count;
+    gap_end_ += count;
+  }
+}
+
+// Grow the gap so that `length` bytes can be inserted at its start.
+void GapBuffer::Reserve(size_t length) {
+  size_t gap = gap_end_ - gap_start_;
+  if (gap >= length) {
+    return;
+  }
+  size_t growth = std::max({length - gap, data_.size(), kMinimumGap});
+  size_t tail = data_.size() - gap_end_;
+  data_.resize(data_.size() + growth);
+  std::memmove(&data_[data_.size() - tail], &data_[gap_end_], tail);
+  gap_end_ += growth;
+}
+
+void GapBuffer::Replace(size_t start, size_t end, const std::string &text) {
+  MoveGap(start);
+  gap_end_ += end - start;
+  Reserve(text.size());
+  std::memcpy(&data_[gap_start_], text.data(), text.size());
+  gap_start_ += text.size();
+
+  // Lines that started inside the replaced text are gone, the new text may
+  // start some lines of its own, and every later line moves by the same delta.
+  auto first = std::upper_bound(line_starts_.begin(), line_starts_.end(), start);
+  auto last = std::upper_bound(first, line_starts_.end(), end);
+  int64_t delta = static_cast<int64_t>(text.size()) - static_cast<int64_t>(end - start);
+  for (auto it = last; it != line_starts_.end(); ++it) {
+    *it = static_cast<uint32_t>(*it + delta);
+  }
+  std::vector<uint32_t> new_starts;
+  size_t unit = BytesPerCharacter(encoding_);
+  for (size_t i = 0; i + unit <= text.size(); i += unit) {
+    if (IsNewline(&text[i])) {
+      new_starts.push_back(static_cast<uint32_t>(start + i + unit));
+    }
+  }
+  first = line_starts_.erase(first, last);
+  line_starts_.insert(first, new_starts.begin(), new_starts.end());
+}
+
+TSPoint GapBuffer::PointAt(size_t byte) const {
+  auto line = std::upper_bound(line_starts_.begin(), line_starts_.end(), byte) - 1;
+  return {static_cast<uint32_t>(line - line_starts_.begin()), static_cast<uint32_t>(byte - *line)};
+}
+
+// Points past the end of a line are clamped to just before its newline, and
+// points past the end of the text are clamped to the end of the text.
+size_t GapBuffer::ByteAt(TSPoint point) const {
+  if (point.row >= line_starts_.size()) {
+    return Length();
+  }
+  size_t line_end = point.row + 1 < line_starts_.size()
+    ? line_starts_[point.row + 1] - BytesPerCharacter(encoding_)
+    : Length();
+  return std::min(static_cast<size_t>(line_starts_[point.row]) + point.column, line_end);
+}
+
+std::string GapBuffer::Slice(size_t start, size_t end) const {
+  std::string result;
+  result.reserve(end - start);
+  if (start < gap_start_) {
+    result.append(data_.data() + start, std::min(end, gap_start_) - start);
+  }
+  if (end > gap_start_) {
+    size_t from = std::max(start, gap_start_);
+    result.append(data_.data() + from + (gap_end_ - gap_start_), end - from);
+  }
+  return result;
+}
+
+std::string GapBuffer::Contents() const {
+  std::string result;
+  result.reserve(Length());
+  result.append(data_.data(), gap_start_);
+  result.append(data_.data() + gap_end_, data_.size() - gap_end_);
+  return result;
+}
+
+TSInput GapBuffer::Input() {
+  TSInput result;
+  result.payload = static_cast<void *>(this);
+  result.encoding = encoding_;
+  result.read = Read;
+  result.decode = nullptr;
+  return result;
+}
+
+const char * GapBuffer::Read(void *payload, uint32_t byte, TSPoint /*position*/, uint32_t *bytes_read) {
+  auto *buffer = static_cast<GapBuffer *>(payload);
+  if (byte < buffer->gap_start_) {
+    *bytes_read = buffer->gap_start_ - byte;
+    return buffer->data_.data() + byte;
+  }
+  size_t offset = byte + (buffer->gap_end_ - buffer->gap_start_);
+  if (offset >= buffer->data_.size()) {
+    *bytes_read = 0;
+    return "";
+  }
+  *bytes_read = buffer->data_.size() - offset;
+  return buffer->data_.data() + offset;
+}
+
+void Document::Init(Napi::Env env, Napi::Object exports) {
+  Function ctor = DefineClass(env, "Document", {
+    InstanceMethod("_tree", &Document::GetTree, napi_default_method),
+    InstanceMethod("getText", &Document::GetText, napi_default_method),
+    InstanceMethod("getLanguage", &Document::GetLanguage, napi_default_method),
+    InstanceMethod("getEncoding", &Document::GetEncoding, napi_default_method),
+    InstanceMethod("_applyTextEdits", &Document::ApplyTextEdits, napi_default_method),
+    InstanceMethod("_layers", &Document::GetLayers, napi_default_method),
+  });
+
+  exports["Document"] = ctor;
+}
+
+Document::Document(const Napi::CallbackInfo &info)
+  : Napi::ObjectWrap<Document>(info),
+    parser_(ts_parser_new()),
+    text_(gap_buffer_from_js(info[1], info[2])) {
+  Napi::Env env = info.Env();
+
+  const TSLanguage *language = language_methods::UnwrapLanguage(info[0]);
+  if (language == nullptr || !ts_parser_set_language(parser_.get(), language)) {
+    throw TypeError::New(env, "First argument must be a language");
+  }
+  language_ref_ = Napi::Persistent(info[0]);
+  ReadInjections(info[3]);
+  Reparse(env, nullptr);
+}
+
+// Read a list of `{language, query, parentLanguage}` injections. The query
+// runs on every layer in the parent language, which defaults to the
+// document's language.
+void Document::ReadInjections(const Napi::Value &js_injections) {
+  Napi::Env env = js_injections.Env();
+  if (js_injections.IsUndefined() || js_injections.IsNull()) {
+    return;
+  }
+  if (!js_injections.IsArray()) {
+    throw TypeError::New(env, "Injections must be an array");
+  }
+
+  auto array = js_injections.As<Array>();
+  for (uint32_t i = 0; i < array.Length(); i++) {
+    Napi::Value js_injection = array[i];
+    if (!js_injection.IsObject()) {
+      throw TypeError::New(env, "Injection must be a {language, query} object");
+    }
+    auto object = js_injection.As<Object>();
+    Napi::Value js_language = object["language"];
+    Napi::Value js_query = object["query"];
+    Napi::Value js_parent_language = object["parentLanguage"];
+
+    Injection injection;
+    injection.language = language_methods::UnwrapLanguage(js_language);
+    Query *query = Query::UnwrapQuery(js_query);
+    if (injection.language == nullptr || query == nullptr) {
+      throw TypeError::New(env, "Injection must be a {language, query} object");
+    }
+    injection.query = query->GetTSQuery();
+    injection.parent_language = js_parent_language.IsUndefined()
+      ? ts_parser_language(parser_.get())
+      : language_methods::UnwrapLanguage(js_parent_language);
+    if (injection.parent_language == nullptr) {
+      throw TypeError::New(env, "Injection's parent language must be a language");
+    }
+
+    injection.content_capture = UINT32_MAX;
+    for (uint32_t capture = 0; capture < ts_query_capture_count(injection.query); capture++) {
+      uint32_t length;
+      const char *name = ts_query_capture_name_for_id(injection.query, capture, &length);
+      if (std::string(name, length) == "injection.content") {
+        injection.content_capture = capture;
+      }
+    }
+    if (injection.content_capture == UINT32_MAX) {
+      throw TypeError::New(env, "Injection query must have an @injection.content capture");
+    }
+
+    injection.language_ref = Napi::Persistent(js_language);
+    injection.query_ref = Napi::Persistent(js_query);
+    injections_.push_back(std::move(injection));
+  }
+}
+
+// Parse the current text and make the result the document's tree, then find
+// and parse its injected layers. Every tree keeps a snapshot of the text it
+// was parsed from, so that its nodes' text stays correct after later edits.
+// Taking the snapshot doesn't copy the text.
+void Document::Reparse(Napi::Env env, const TSTree *old_tree) {
+  TreePtr tree(ts_parser_parse(parser_.get(), old_tree, text_.Input()));
+  if (!tree) {
+    throw Error::New(env, "Failed to parse the document");
+  }
+  tree_ = std::move(tree);
+
+  if (!injections_.empty()) {
+    std::vector<Layer> old_layers = std::move(layers_);
+    layers_.clear();
+    std::vector<const TSTree *> parents {tree_.get()};
+    for (uint32_t depth = 1; depth <= kMaxInjectionDepth && !parents.empty(); depth++) {
+      std::vector<Layer> found = FindLayers(parents, depth);
+      ParseLayers(env, &found, &old_layers);
+      parents.clear();
+      for (Layer &layer : found) {
+        parents.push_back(layer.tree.get());
+        layers_.push_back(std::move(layer));
+      }
+    }
+  }
+
+  snapshot_ = Snapshot();
+  tree_ref_ = Napi::Persistent(NewTree(env, tree_.get()).As<Object>());
+
+  if (!injections_.empty()) {
+    Array js_layers = Array::New(env, layers_.size());
+    for (uint32_t i = 0; i < layers_.size(); i++) {
+      const Layer &layer = layers_[i];
+      Object js_layer = Object::New(env);
+      js_layer["language"] = injections_[layer.injection].language_ref.Value();
+      js_layer["depth"] = Number::New(env, layer.depth);
+      js_layer["range"] = RangeToJS(env, layer.range, text_.Encoding());
+      js_layer["tree"] = NewTree(env, layer.tree.get());
+      js_layers[i] = js_layer;
+    }
+    layers_ref_ = Napi::Persistent(js_layers.As<Object>());
+  }
+}
+
+std::shared_ptr<SourceFile> Document::Snapshot() {
+  if (!snapshot_base_ || snapshot_edit_count_ >= kMaxSnapshotEdits || snapshot_edit_bytes_ > snapshot_base_->size()) {
+    snapshot_base_ = std::make_shared<const std::string>(text_.Contents());
+    snapshot_edits_ = nullptr;
+    snapshot_edit_count_ = 0;
+    snapshot_edit_bytes_ = 0;
+  }
+
+  std::shared_ptr<const std::string> base = snapshot_base_;
+  std::shared_ptr<const SnapshotEdit> edits = snapshot_edits_;
+  TSInputEncoding encoding = text_.Encoding();
+  return SourceFile::Lazy([base, edits, encoding] {
+    std::vector<const SnapshotEdit *> ordered;
+    for (const SnapshotEdit *edit = edits.get(); edit != nullptr; edit = edit->previous.get()) {
+      ordered.push_back(edit);
+    }
+    if (ordered.empty()) {
+      return *base;
+    }
+    GapBuffer buffer(*base, encoding);
+    for (auto it = ordered.rbegin(); it != ordered.rend(); ++it) {
+      buffer.Replace((*it)->start, (*it)->end, (*it)->text);
+    }
+    return buffer.Contents();
+  });
+}
+
+Napi::Value Document::NewTree(Napi::Env env, const TSTree *tree) {
+  Napi::Value js_tree = Tree::NewInstance(env, ts_tree_copy(tree), text_.Encoding());
+  Tree::Unwrap(js_tree.As<Object>())->source_ = snapshot_;
+  return js_tree;
+}
+
+// Run the injection queries on each parent layer, and return a layer for
+// every captured range. Their trees are not parsed yet.
+std::vector<Document::Layer> Document::FindLayers(const std::vector<const TSTree *> &parents, uint32_t depth) const {
+  std::vector<Layer> result;
+  TSQueryCursor *cursor = ts_query_cursor_new();
+  for (const TSTree *parent : parents) {
+    const TSLanguage *parent_language = ts_tree_language(parent);
+    for (size_t i = 0; i < injections_.size(); i++) {
+      const Injection &injection = injections_[i];
+      if (injection.parent_language != parent_language) {
+        continue;
+      }
+      ts_query_cursor_exec(cursor, injection.query, ts_tree_root_node(parent));
+      TSQueryMatch match;
+      while (ts_query_cursor_next_match(cursor, &match)) {
+        for (uint16_t j = 0; j < match.capture_count; j++) {
+          TSNode node = match.captures[j].node;
+          if (match.captures[j].index != injection.content_capture ||
+              ts_node_start_byte(node) == ts_node_end_byte(node)) {
+            continue;
+          }
+          TSRange range {
+            ts_node_start_point(node),
+            ts_node_end_point(node),
+            ts_node_start_byte(node),
+            ts_node_end_byte(node),
+          };
+          result.push_back({i, depth, range, nullptr, false});
+        }
+      }
+    }
+  }
+  ts_query_cursor_delete(cursor);
+  return result;
+}
+
+// Give each layer a tree. A layer whose range matches an old layer that no
+// edit has touched takes over the old tree as is. The others are parsed on a
+// pool of threads that is shared by every document and kept between
+// reparses, incrementally when an old layer starts at the same place. Layers
+// that fail to parse are dropped.
+void Document::ParseLayers(Napi::Env env, std::vector<Layer> *layers, std::vector<Layer> *old_layers) {
+  std::map<std::tuple<size_t, uint32_t, uint32_t>, Layer *> old_by_start;
+  for (Layer &old : *old_layers) {
+    if (old.tree) {
+      old_by_start.emplace(std::make_tuple(old.injection, old.depth, old.range.start_byte), &old);
+    }
+  }
+
+  std::vector<std::pair<Layer *, const TSTree *>> pending;
+  for (Layer &layer : *layers) {
+    auto found = old_by_start.find(std::make_tuple(layer.injection, layer.depth, layer.range.start_byte));
+    if (found == old_by_start.end()) {
+      pending.emplace_back(&layer, nullptr);
+      continue;
+    }
+    Layer *old = found->second;
+    old_by_start.erase(found);
+    if (!old->edited && old->range.end_byte == layer.range.end_byte) {
+      layer.tree = std::move(old->tree);
+    } else {
+      pending.emplace_back(&layer, old->tree.get());
+    }
+  }
+
+  TSInput input = text_.Input();
+  if (!pending.empty()) {
+    env.GetInstanceData<AddonData>()->GetParsePool().Run(pending.size(), [&](TSParser *parser, size_t i) {
+      Layer *layer = pending[i].first;
+      if (ts_parser_set_language(parser, injections_[layer->injection].language) &&
+          ts_parser_set_included_ranges(parser, &layer->range, 1)) {
+        layer->tree.reset(ts_parser_parse(parser, pending[i].second, input));
+      }
+    });
+  }
+
+  layers->erase(
+    std::remove_if(layers->begin(), layers->end(), [](const Layer &layer) { return !layer.tree; }),
+    layers->end()
+  );
+}
+
+Napi::Value Document::GetTree(const Napi::CallbackInfo &info) {
+  return tree_ref_.Value();
+}
+
+Napi::Value Document::GetText(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+  std::string text = text_.Contents();
+  if (text_.Encoding() == TSInputEncodingUTF8) {
+    return String::New(env, text.data(), text.size());
+  }
+  return String::New(env, reinterpret_cast<const char16_t *>(text.data()), text.size() / 2);
+}
+
+// Returns an array of `{language, depth, range, tree}` objects, one for each
+// injected layer, in the order they were found.
+Napi::Value Document::GetLayers(const Napi::CallbackInfo &info) {
+  if (layers_ref_.IsEmpty()) {
+    return Array::New(info.Env());
+  }
+  return layers_ref_.Value();
+}
+
+Napi::Value Document::GetLanguage(const Napi::CallbackInfo &info) {
+  return language_ref_.Value();
+}
+
+Napi::Value Document::GetEncoding(const Napi::CallbackInfo &info) {
+  return String::New(info.Env(), text_.Encoding() == TSInputEncodingUTF8 ? "utf8" : "utf16le");
+}
+
+namespace {
+
+// Edit a layer's tree, and move its range the same way that the tree's
+// included ranges move.
+void edit_layer(Document::Layer *layer, const TSInputEdit &edit) {
+  if (edit.start_byte <= layer->range.end_byte && edit.old_end_byte >= layer->range.start_byte) {
+    layer->edited = true;
+  }
+  ts_tree_edit(layer->tree.get(), &edit);
+  uint32_t range_count;
+  TSRange *ranges = ts_tree_included_ranges(layer->tree.get(), &range_count);
+  if (range_count > 0) {
+    layer->range = ranges[0];
+  }
+  free(ranges);
+}
+
+} // namespace
+
+// Apply a list of `{range, text}` edits in order, each one relative to the
+// text produced by the ones before it. A range is given either by
+// `startIndex` and `endIndex` or by `startPosition` and `endPosition`. The
+// tree is edited along with the text, and reparsed once at the end.
+Napi::Value Document::ApplyTextEdits(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+  if (!info[0].IsArray()) {
+    throw TypeError::New(env, "Edits must be an array");
+  }
+  auto js_edits = info[0].As<Array>();
+  TSInputEncoding encoding = text_.Encoding();
+  uint32_t unit = BytesPerCharacter(encoding);
+
+  // Later edits are read against the text as the earlier ones left it, so the
+  // text is edited as the edits are read. If one of them is invalid, the text
+  // is put back the way it was, and nothing else has been changed yet.
+  struct AppliedEdit {
+    TSInputEdit edit;
+    std::string text;
+    std::string removed;
+  };
+  std::vector<AppliedEdit> applied;
+  try {
+    for (uint32_t i = 0; i < js_edits.Length(); i++) {
+      Napi::Value js_edit = js_edits[i];
+      if (!js_edit.IsObject()) {
+        throw TypeError::New(env, "Edit must be a {range, text} object");
+      }
+      Napi::Value js_range = js_edit.As<Object>()["range"];
+      if (!js_range.IsObject()) {
+        throw TypeError::New(env, "Edit must be a {range, text} object");
+      }
+      auto range = js_range.As<Object>();
+
+      size_t start;
+      size_t end;
+      if (range.Has("startIndex")) {
+        auto start_index = ByteCountFromJS(range["startIndex"], encoding);
+        auto end_index = ByteCountFromJS(range["endIndex"], encoding);
+        if (start_index.IsNothing() || end_index.IsNothing()) {
+          throw env.GetAndClearPendingException();
+        }
+        start = start_index.Unwrap();
+        end = end_index.Unwrap();
+      } else {
+        auto start_position = PointFromJS(range["startPosition"], encoding);
+        auto end_position = PointFromJS(range["endPosition"], encoding);
+        if (start_position.IsNothing() || end_position.IsNothing()) {
+          throw env.GetAndClearPendingException();
+        }
+        start = text_.ByteAt(start_position.Unwrap());
+        end = text_.ByteAt(end_position.Unwrap());
+      }
+      if (start > end || end > text_.Length() || start % unit != 0 || end % unit != 0) {
+        throw RangeError::New(env, "Edit range is out of bounds");
+      }
+
+      std::string text = text_from_js(js_edit.As<Object>()["text"], encoding);
+      if (text.size() % unit != 0) {
+        throw RangeError::New(env, "Edit text is not valid in the document's encoding");
+      }
+
+      TSInputEdit edit;
+      edit.start_byte = start;
+      edit.old_end_byte = end;
+      edit.new_end_byte = start + text.size();
+      edit.start_point = text_.PointAt(start);
+      edit.old_end_point = text_.PointAt(end);
+      std::string removed = text_.Slice(start, end);
+      text_.Replace(start, end, text);
+      edit.new_end_point = text_.PointAt(edit.new_end_byte);
+      applied.push_back({edit, std::move(text), std::move(removed)});
+    }
+  } catch (...) {
+    for (auto it = applied.rbegin(); it != applied.rend(); ++it) {
+      text_.Replace(it->edit.start_byte, it->edit.new_end_byte, it->removed);
+    }
+    throw;
+  }
+
+  TreePtr tree(ts_tree_copy(tree_.get()));
+  for (AppliedEdit &applied_edit : applied) {
+    const TSInputEdit &edit = applied_edit.edit;
+    snapshot_edit_count_++;
+    snapshot_edit_bytes_ += applied_edit.text.size();
+    snapshot_edits_ = std::make_shared<const SnapshotEdit>(
+      SnapshotEdit {edit.start_byte, edit.old_end_byte, std::move(applied_edit.text), snapshot_edits_}
+    );
+    ts_tree_edit(tree.get(), &edit);
+    for (Layer &layer : layers_) {
+      edit_layer(&layer, edit);
+    }
+  }
+
+  Reparse(env, tree.get());
+  return tree_ref_.Value();
+}
+
+} // namespace node_tree_sitter
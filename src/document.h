@@ -0,0 +1,135 @@
+#ifndef NODE_TREE_SITTER_DOCUMENT_H_
+#define NODE_TREE_SITTER_DOCUMENT_H_
+
+#include "./source_file.h"
+#include "tree_sitter/api.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <napi.h>
+#include <string>
+#include <vector>
+
+namespace node_tree_sitter {
+
+struct ParserDeleter {
+  void operator()(TSParser *parser) const { ts_parser_delete(parser); }
+};
+
+struct TreeDeleter {
+  void operator()(TSTree *tree) const { ts_tree_delete(tree); }
+};
+
+using ParserPtr = std::unique_ptr<TSParser, ParserDeleter>;
+using TreePtr = std::unique_ptr<TSTree, TreeDeleter>;
+
+// Text stored with a gap at the most recent edit, so that a run of nearby
+// edits only moves the text between them. The byte offset of every line start
+// is kept up to date, so that points can be found without scanning the text.
+class GapBuffer final {
+ public:
+  GapBuffer(std::string text, TSInputEncoding encoding);
+
+  size_t Length() const { return data_.size() - (gap_end_ - gap_start_); }
+  TSInputEncoding Encoding() const { return encoding_; }
+
+  // Replace the bytes in [start, end) with the given text.
+  void Replace(size_t start, size_t end, const std::string &text);
+
+  TSPoint PointAt(size_t byte) const;
+  size_t ByteAt(TSPoint point) const;
+  std::string Slice(size_t start, size_t end) const;
+  std::string Contents() const;
+
+  TSInput Input();
+
+ private:
+  static const char * Read(void *payload, uint32_t byte, TSPoint position, uint32_t *bytes_read);
+
+  void MoveGap(size_t position);
+  void Reserve(size_t length);
+  bool IsNewline(const char *data) const;
+
+  std::vector<char> data_;
+  size_t gap_start_;
+  size_t gap_end_;
+  std::vector<uint32_t> line_starts_;
+  TSInputEncoding encoding_;
+};
+
+// A document that owns its text and its latest syntax tree. Edits update the
+// text natively, adjust the tree, and reparse without calling back into JS.
+//
+// A document can also have injections: queries whose `@injection.content`
+// captures mark ranges of text written in another language. Each captured
+// range becomes a layer with its own tree, parsed with that range as its
+// included range, and layers can have injections of their own.
+class Document final : public Napi::ObjectWrap<Document> {
+ public:
+  static void Init(Napi::Env env, Napi::Object exports);
+
+  explicit Document(const Napi::CallbackInfo &info);
+
+  struct Injection {
+    const TSLanguage *parent_language;
+    const TSLanguage *language;
+    const TSQuery *query;
+    uint32_t content_capture;
+    Napi::Reference<Napi::Value> language_ref;
+    Napi::Reference<Napi::Value> query_ref;
+  };
+
+  struct Layer {
+    size_t injection;
+    uint32_t depth;
+    TSRange range;
+    TreePtr tree;
+    // Whether an edit has touched the layer's range since it was parsed.
+    bool edited;
+  };
+
+  // One replacement in a persistent list of the edits made since the last
+  // snapshot base, newest first.
+  struct SnapshotEdit {
+    size_t start;
+    size_t end;
+    std::string text;
+    std::shared_ptr<const SnapshotEdit> previous;
+  };
+
+ private:
+  ParserPtr parser_;
+  TreePtr tree_;
+  GapBuffer text_;
+  std::shared_ptr<SourceFile> snapshot_;
+  // Snapshots share the text as of some earlier version and the edits made
+  // since then, and only replay the edits if their text is read.
+  std::shared_ptr<const std::string> snapshot_base_;
+  std::shared_ptr<const SnapshotEdit> snapshot_edits_;
+  size_t snapshot_edit_count_ = 0;
+  size_t snapshot_edit_bytes_ = 0;
+  Napi::Reference<Napi::Value> language_ref_;
+  Napi::ObjectReference tree_ref_;
+  std::vector<Injection> injections_;
+  std::vector<Layer> layers_;
+  Napi::ObjectReference layers_ref_;
+
+  void ReadInjections(const Napi::Value &js_injections);
+  void Reparse(Napi::Env env, const TSTree *old_tree);
+  std::shared_ptr<SourceFile> Snapshot();
+  std::vector<Layer> FindLayers(const std::vector<const TSTree *> &parents, uint32_t depth) const;
+  void ParseLayers(Napi::Env env, std::vector<Layer> *layers, std::vector<Layer> *old_layers);
+  Napi::Value NewTree(Napi::Env env, const TSTree *tree);
+
+  Napi::Value GetTree(const Napi::CallbackInfo &info);
+  Napi::Value GetText(const Napi::CallbackInfo &info);
+  Napi::Value GetLanguage(const Napi::CallbackInfo &info);
+  Napi::Value GetEncoding(const Napi::CallbackInfo &info);
+  Napi::Value ApplyTextEdits(const Napi::CallbackInfo &info);
+  Napi::Value GetLayers(const Napi::CallbackInfo &info);
+};
+
+} // namespace node_tree_sitter
+
+#endif // NODE_TREE_SITTER_DOCUMENT_H_
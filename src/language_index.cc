@@ -0,0 +1,76 @@
+#include "./language_index.h"
+
+#include <utility>
+
+namespace node_tree_sitter {
+
+namespace {
+
+// Type lists are usually written out in the source, so there are few of them.
+// The cache is cleared if a program builds them dynamically.
+const size_t MAX_SYMBOL_SETS = 256;
+
+} // namespace
+
+void SymbolSet::add(TSSymbol symbol) {
+  if (symbol == ERROR_SYMBOL) {
+    contains_error_ = true;
+    return;
+  }
+  size_t word = symbol / 64;
+  if (word >= bits_.size()) {
+    bits_.resize(word + 1);
+  }
+  bits_[word] |= uint64_t{1} << (symbol % 64);
+}
+
+LanguageIndex::LanguageIndex(const TSLanguage *language)
+  : symbol_count_(ts_language_symbol_count(language)) {
+  for (TSSymbol i = 0; i < static_cast<TSSymbol>(symbol_count_); i++) {
+    symbols_by_name_[ts_language_symbol_name(language, i)].push_back(i);
+  }
+
+  uint32_t field_count = ts_language_field_count(language);
+  for (TSFieldId i = 1; i <= field_count; i++) {
+    const char *name = ts_language_field_name_for_id(language, i);
+    if (name != nullptr) {
+      fields_by_name_.emplace(name, i);
+    }
+  }
+}
+
+TSFieldId LanguageIndex::FieldIdForName(const std::string &name) const {
+  auto entry = fields_by_name_.find(name);
+  return entry == fields_by_name_.end() ? 0 : entry->second;
+}
+
+const SymbolSet &LanguageIndex::SymbolSetForTypes(const std::string &types) {
+  auto entry = symbol_sets_.find(types);
+  if (entry != symbol_sets_.end()) {
+    return entry->second;
+  }
+
+  if (symbol_sets_.size() >= MAX_SYMBOL_SETS) {
+    symbol_sets_.clear();
+  }
+
+  SymbolSet symbols(symbol_count_);
+  for (size_t start = 0; start < types.size();) {
+    size_t end = types.find('\0', start);
+    std::string type = types.substr(start, end - start);
+    if (type == "ERROR") {
+      symbols.add(SymbolSet::ERROR_SYMBOL);
+    } else {
+      auto matches = symbols_by_name_.find(type);
+      if (matches != symbols_by_name_.end()) {
+        for (TSSymbol symbol : matches->second) {
+          symbols.add(symbol);
+        }
+      }
+    }
+    start = end + 1;
+  }
+  return symbol_sets_.emplace(types, std::move(symbols)).first->second;
+}
+
+} // namespace node_tree_sitter
@@ -0,0 +1,57 @@
+#ifndef NODE_TREE_SITTER_LANGUAGE_INDEX_H_
+#define NODE_TREE_SITTER_LANGUAGE_INDEX_H_
+
+#include "tree_sitter/api.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace node_tree_sitter {
+
+// A set of symbols of one language, as a bitset over its symbol ids. The error
+// symbol lies outside that range, so it's tracked separately.
+class SymbolSet final {
+ public:
+  explicit SymbolSet(uint32_t symbol_count = 0) : bits_((symbol_count + 63) / 64) {}
+
+  void add(TSSymbol symbol);
+  [[nodiscard]] bool contains(TSSymbol symbol) const {
+    if (symbol == ERROR_SYMBOL) {
+      return contains_error_;
+    }
+    size_t word = symbol / 64;
+    return word < bits_.size() && ((bits_[word] >> (symbol % 64)) & 1) != 0;
+  }
+
+  static const TSSymbol ERROR_SYMBOL = static_cast<TSSymbol>(-1);
+
+ private:
+  std::vector<uint64_t> bits_;
+  bool contains_error_ = false;
+};
+
+// Lookups from node type and field names to ids for one language, built the
+// first time the language is searched by name.
+class LanguageIndex final {
+ public:
+  explicit LanguageIndex(const TSLanguage *language);
+
+  TSFieldId FieldIdForName(const std::string &name) const;
+
+  // The symbols with any of the given type names, which are separated by
+  // '\0'. Sets are kept per list of names, so searching for the same types
+  // again doesn't rebuild them. The set is valid until the next call.
+  const SymbolSet &SymbolSetForTypes(const std::string &types);
+
+ private:
+  uint32_t symbol_count_;
+  std::unordered_map<std::string, std::vector<TSSymbol>> symbols_by_name_;
+  std::unordered_map<std::string, TSFieldId> fields_by_name_;
+  std::unordered_map<std::string, SymbolSet> symbol_sets_;
+};
+
+} // namespace node_tree_sitter
+
+#endif // NODE_TREE_SITTER_LANGUAGE_INDEX_H_
@@ -1,6 +1,9 @@
 #include "./logger.h"
 #include "tree_sitter/api.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <napi.h>
 #include <string>
 
@@ -67,4 +70,180 @@ TSLogger Logger::Make(const Napi::Function &func) {
   return result;
 }
 
+/*
+  tstag log_buffer # => 0x8AF2E5212AD58ABF, 0x5102FC6EB1F9D1E2
+*/
+const napi_type_tag LOG_BUFFER_TYPE_TAG = {
+  0x8AF2E5212AD58ABF, 0x5102FC6EB1F9D1E2
+};
+
+namespace {
+
+const size_t kDefaultLogBufferBytes = 1024 * 1024;
+
+} // namespace
+
+void LogBuffer::Init(Napi::Env env, Napi::Object exports) {
+  Function ctor = DefineClass(env, "LogBuffer", {
+    InstanceMethod("drain", &LogBuffer::Drain, napi_default_method),
+    InstanceMethod("getStats", &LogBuffer::GetStats, napi_default_method),
+  });
+
+  exports["LogBuffer"] = ctor;
+}
+
+LogBuffer *LogBuffer::UnwrapLogBuffer(const Napi::Value &value) {
+  if (!value.IsObject()) {
+    return nullptr;
+  }
+  auto js_buffer = value.As<Object>();
+  if (!js_buffer.CheckTypeTag(&LOG_BUFFER_TYPE_TAG)) {
+    return nullptr;
+  }
+  return LogBuffer::Unwrap(js_buffer);
+}
+
+// new LogBuffer(capacity, {types, prefixes})
+LogBuffer::LogBuffer(const Napi::CallbackInfo &info) : Napi::ObjectWrap<LogBuffer>(info) {
+  Napi::Env env = info.Env();
+  Value().TypeTag(&LOG_BUFFER_TYPE_TAG);
+
+  size_t capacity = kDefaultLogBufferBytes;
+  if (info[0].IsNumber()) {
+    // Record offsets are stored in 32 bits, so larger buffers can't be used.
+    double js_capacity = info[0].As<Number>().DoubleValue();
+    if (js_capacity != std::floor(js_capacity) || js_capacity < kHeaderSize || js_capacity > UINT32_MAX) {
+      throw RangeError::New(env, "Capacity must be an integer between 4 and 4294967295");
+    }
+    capacity = static_cast<size_t>(js_capacity);
+  } else if (!info[0].IsUndefined()) {
+    throw TypeError::New(env, "Capacity must be a number of bytes");
+  }
+  buffer_.resize(capacity);
+
+  Napi::Value js_types_value = env.Undefined();
+  Napi::Value js_prefixes_value = env.Undefined();
+  if (info[1].IsObject()) {
+    js_types_value = info[1].As<Object>()["types"];
+    js_prefixes_value = info[1].As<Object>()["prefixes"];
+  }
+
+  if (js_types_value.IsArray()) {
+    auto js_types = js_types_value.As<Array>();
+    log_parse_ = false;
+    log_lex_ = false;
+    for (uint32_t i = 0; i < js_types.Length(); i++) {
+      Napi::Value js_type = js_types[i];
+      std::string type = js_type.IsString() ? js_type.As<String>().Utf8Value() : "";
+      if (type == "parse") {
+        log_parse_ = true;
+      } else if (type == "lex") {
+        log_lex_ = true;
+      } else {
+        throw TypeError::New(env, "Log types must be 'parse' or 'lex'");
+      }
+    }
+  }
+
+  if (js_prefixes_value.IsArray()) {
+    auto js_prefixes = js_prefixes_value.As<Array>();
+    for (uint32_t i = 0; i < js_prefixes.Length(); i++) {
+      Napi::Value js_prefix = js_prefixes[i];
+      if (!js_prefix.IsString()) {
+        throw TypeError::New(env, "Message prefixes must be strings");
+      }
+      prefixes_.push_back(js_prefix.As<String>().Utf8Value());
+    }
+  }
+}
+
+void LogBuffer::Log(void *payload, TSLogType type, const char *message) {
+  auto *buffer = static_cast<LogBuffer *>(payload);
+  size_t length = std::min<size_t>(strlen(message), UINT16_MAX);
+  if (buffer->Accepts(type, message, length)) {
+    buffer->Write(type, message, length);
+  }
+}
+
+bool LogBuffer::Accepts(TSLogType type, const char *message, size_t length) const {
+  if (!(type == TSLogTypeParse ? log_parse_ : log_lex_)) {
+    return false;
+  }
+  if (prefixes_.empty()) {
+    return true;
+  }
+  for (const std::string &prefix : prefixes_) {
+    if (prefix.size() <= length && memcmp(prefix.data(), message, prefix.size()) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void LogBuffer::Write(TSLogType type, const char *message, size_t length) {
+  length = std::min(length, buffer_.size() - kHeaderSize);
+  size_t record_size = kHeaderSize + length;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  while (buffer_.size() - size_ < record_size) {
+    uint8_t header[kHeaderSize];
+    CopyOut(start_, header, kHeaderSize);
+    size_t dropped_size = kHeaderSize + (header[2] | (header[3] << 8));
+    start_ = (start_ + dropped_size) % buffer_.size();
+    size_ -= dropped_size;
+    records_--;
+    dropped_++;
+  }
+
+  uint8_t header[kHeaderSize] = {
+    static_cast<uint8_t>(type),
+    0,
+    static_cast<uint8_t>(length & 0xFF),
+    static_cast<uint8_t>(length >> 8),
+  };
+  CopyIn(header, kHeaderSize);
+  CopyIn(message, length);
+  records_++;
+  written_++;
+}
+
+// Append bytes at the end of the ring, wrapping around if needed. The caller
+// has made room for them.
+void LogBuffer::CopyIn(const void *data, size_t length) {
+  size_t end = (start_ + size_) % buffer_.size();
+  size_t first = std::min(length, buffer_.size() - end);
+  memcpy(buffer_.data() + end, data, first);
+  memcpy(buffer_.data(), static_cast<const char *>(data) + first, length - first);
+  size_ += length;
+}
+
+void LogBuffer::CopyOut(size_t position, void *data, size_t length) const {
+  size_t first = std::min(length, buffer_.size() - position);
+  memcpy(data, buffer_.data() + position, first);
+  memcpy(static_cast<char *>(data) + first, buffer_.data(), length - first);
+}
+
+// Move every buffered record, oldest first, into a new Buffer.
+Napi::Value LogBuffer::Drain(const Napi::CallbackInfo &info) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Buffer<char> result = Buffer<char>::New(info.Env(), size_);
+  CopyOut(start_, result.Data(), size_);
+  start_ = 0;
+  size_ = 0;
+  records_ = 0;
+  return result;
+}
+
+Napi::Value LogBuffer::GetStats(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+  std::lock_guard<std::mutex> lock(mutex_);
+  Object result = Object::New(env);
+  result["records"] = Number::New(env, static_cast<double>(records_));
+  result["bytes"] = Number::New(env, static_cast<double>(size_));
+  result["capacity"] = Number::New(env, static_cast<double>(buffer_.size()));
+  result["written"] = Number::New(env, static_cast<double>(written_));
+  result["dropped"] = Number::New(env, static_cast<double>(dropped_));
+  return result;
+}
+
 } // namespace node_tree_sitter
@@ -3,7 +3,12 @@
 
 #include "tree_sitter/api.h"
 
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
 #include <napi.h>
+#include <string>
+#include <vector>
 
 namespace node_tree_sitter {
 
@@ -14,6 +19,48 @@ class Logger final {
   static void Log(void *, TSLogType, const char *);
 };
 
+// A logger that copies each message into a fixed-size ring buffer instead of
+// calling into JS, so it can stay attached during production parses,
+// including those on background threads. Messages are filtered by type and
+// by prefix before they are copied. When the buffer is full, the oldest
+// records are dropped.
+//
+// Each record is a 4-byte header (the log type, a zero byte, and the message
+// length as a little-endian uint16) followed by the message's bytes.
+class LogBuffer final : public Napi::ObjectWrap<LogBuffer> {
+ public:
+  static void Init(Napi::Env env, Napi::Object exports);
+  static LogBuffer *UnwrapLogBuffer(const Napi::Value &value);
+  static void Log(void *, TSLogType, const char *);
+
+  explicit LogBuffer(const Napi::CallbackInfo &info);
+
+  TSLogger Logger() { return {static_cast<void *>(this), Log}; }
+
+ private:
+  static const size_t kHeaderSize = 4;
+
+  bool Accepts(TSLogType type, const char *message, size_t length) const;
+  void Write(TSLogType type, const char *message, size_t length);
+  void CopyIn(const void *data, size_t length);
+  void CopyOut(size_t position, void *data, size_t length) const;
+
+  Napi::Value Drain(const Napi::CallbackInfo &info);
+  Napi::Value GetStats(const Napi::CallbackInfo &info);
+
+  std::mutex mutex_;
+  std::vector<char> buffer_;
+  size_t start_ = 0;
+  size_t size_ = 0;
+  uint64_t records_ = 0;
+  uint64_t written_ = 0;
+  uint64_t dropped_ = 0;
+
+  bool log_parse_ = true;
+  bool log_lex_ = true;
+  std::vector<std::string> prefixes_;
+};
+
 } // namespace node_tree_sitter
 
 #endif // NODE_TREE_SITTER_LOGGER_H_
@@ -76,7 +76,7 @@ LookaheadIterator *LookaheadIterator::UnwrapLookaheadIterator(const Napi::Value
 
 Napi::Value LookaheadIterator::CurrentType(const Napi::CallbackInfo &info) {
   LookaheadIterator *iterator = UnwrapLookaheadIterator(info.This());
-  return Napi::String::New(info.Env(), ts_lookahead_iterator_current_symbol_name(iterator->iterator_));
+  return NameToJS(info.Env(), ts_lookahead_iterator_current_symbol_name(iterator->iterator_));
 }
 
 Napi::Value LookaheadIterator::CurrentTypeId(const Napi::CallbackInfo &info) {
@@ -4,7 +4,11 @@
 #include "./tree_cursor.h"
 #include "tree_sitter/api.h"
 
+#include <algorithm>
+#include <memory>
 #include <napi.h>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 using std::vector;
@@ -12,7 +16,18 @@ using namespace Napi;
 
 namespace node_tree_sitter::node_methods {
 
-const uint32_t FIELD_COUNT_PER_NODE = 6;
+// Each node is transferred as the handle of its slot in its tree's node table.
+const uint32_t FIELD_COUNT_PER_NODE = 1;
+
+// A tree without an identity cache hands out value nodes instead, which carry
+// their node's id, context and edit version in a separate transfer array.
+const uint32_t VALUE_NODE_HANDLE = UINT32_MAX;
+const uint32_t FIELD_COUNT_PER_VALUE_NODE = 7;
+
+// Trees that prefetch geometry also transfer each new node's type id, start
+// and end index, and start and end point, so JS can answer those getters
+// without calling back into native code.
+const uint32_t FIELD_COUNT_PER_NODE_GEOMETRY = 7;
 
 namespace {
 
@@ -25,11 +40,94 @@ inline void setup_transfer_buffer(Napi::Env env, uint32_t node_count) {
 
     auto js_transfer_buffer = Uint32Array::New(env, data->transfer_buffer_length);
     data->transfer_buffer = js_transfer_buffer.Data();
+    auto js_value_transfer_buffer = Uint32Array::New(env, node_count * FIELD_COUNT_PER_VALUE_NODE);
+    data->value_transfer_buffer = js_value_transfer_buffer.Data();
+    auto js_geometry_transfer_buffer = Uint32Array::New(env, node_count * FIELD_COUNT_PER_NODE_GEOMETRY);
+    data->geometry_transfer_buffer = js_geometry_transfer_buffer.Data();
 
     data->module_exports.Value()["nodeTransferArray"] = js_transfer_buffer;
+    data->module_exports.Value()["valueNodeTransferArray"] = js_value_transfer_buffer;
+    data->module_exports.Value()["nodeGeometryTransferArray"] = js_geometry_transfer_buffer;
+  }
+}
+
+void marshal_node_geometry(AddonData *data, const Tree *tree, TSNode node, uint32_t offset) {
+  uint32_t *p = &data->geometry_transfer_buffer[offset * FIELD_COUNT_PER_NODE_GEOMETRY];
+  uint32_t bytes_per_character = BytesPerCharacter(tree->encoding_);
+  TSPoint start = ts_node_start_point(node);
+  TSPoint end = ts_node_end_point(node);
+  p[0] = ts_node_symbol(node);
+  p[1] = ts_node_start_byte(node) / bytes_per_character;
+  p[2] = ts_node_end_byte(node) / bytes_per_character;
+  p[3] = start.row;
+  p[4] = start.column / bytes_per_character;
+  p[5] = end.row;
+  p[6] = end.column / bytes_per_character;
+}
+
+void marshal_value_node(AddonData *data, const Tree *tree, TSNode node, uint32_t offset) {
+  uint32_t *p = &data->value_transfer_buffer[offset * FIELD_COUNT_PER_VALUE_NODE];
+  uint64_t id = reinterpret_cast<uintptr_t>(node.id);
+  p[0] = static_cast<uint32_t>(id);
+  p[1] = static_cast<uint32_t>(id >> 32);
+  p[2] = node.context[0];
+  p[3] = node.context[1];
+  p[4] = node.context[2];
+  p[5] = node.context[3];
+  p[6] = tree->EditCount();
+  data->transfer_buffer[offset] = VALUE_NODE_HANDLE;
+  if (tree->prefetch_geometry_) {
+    marshal_node_geometry(data, tree, node, offset);
   }
 }
 
+TSNode value_node_from_fields(Napi::Env env, const Tree *tree, const uint32_t *p) {
+  if (p[6] < tree->edit_log_base_) {
+    throw Error::New(env, "Stale node: the edits made since it was created are no longer kept");
+  }
+  uint64_t id = p[0] | (static_cast<uint64_t>(p[1]) << 32);
+  TSNode node = {{p[2], p[3], p[4], p[5]}, reinterpret_cast<const void *>(static_cast<uintptr_t>(id)), tree->tree_};
+  return tree->ApplyEdits(node, p[6]);
+}
+
+TSNode unmarshal_value_node(Napi::Env env, AddonData *data, const Tree *tree, uint32_t offset) {
+  return value_node_from_fields(env, tree, &data->value_transfer_buffer[offset * FIELD_COUNT_PER_VALUE_NODE]);
+}
+
+// The attributes that `bulkAttributes` can fill, as bits of its field mask
+// and indices into its array of outputs.
+enum NodeAttribute : uint8_t {
+  kTypeIdAttribute,
+  kStartIndexAttribute,
+  kEndIndexAttribute,
+  kStartRowAttribute,
+  kStartColumnAttribute,
+  kEndRowAttribute,
+  kEndColumnAttribute,
+  kFlagsAttribute,
+  kAttributeCount,
+};
+
+enum NodeFlag : uint32_t {
+  kNamedFlag = 1 << 0,
+  kMissingFlag = 1 << 1,
+  kExtraFlag = 1 << 2,
+  kHasErrorFlag = 1 << 3,
+  kErrorFlag = 1 << 4,
+  kHasChangesFlag = 1 << 5,
+};
+
+uint32_t node_flags(TSNode node) {
+  uint32_t flags = 0;
+  if (ts_node_is_named(node)) flags |= kNamedFlag;
+  if (ts_node_is_missing(node)) flags |= kMissingFlag;
+  if (ts_node_is_extra(node)) flags |= kExtraFlag;
+  if (ts_node_has_error(node)) flags |= kHasErrorFlag;
+  if (ts_node_is_error(node)) flags |= kErrorFlag;
+  if (ts_node_has_changes(node)) flags |= kHasChangesFlag;
+  return flags;
+}
+
 inline bool operator<=(const TSPoint &left, const TSPoint &right) {
   if (left.row < right.row) {
     return true;
@@ -51,6 +149,10 @@ Napi::Value MarshalNode(const Napi::CallbackInfo &info, const Tree *tree, TSNode
   return GetMarshalNode(info, tree, node);
 }
 
+// Nodes that JS has been given an object for keep their handle, so that JS
+// can find that object again, and the others are added to the tree's node
+// table. Their handles are written to the transfer buffer in order. A node
+// that appears more than once gets a single handle.
 Napi::Value GetMarshalNodes(const Napi::CallbackInfo &info,
                          const Tree *tree, const TSNode *nodes, uint32_t node_count) {
   Env env = info.Env();
@@ -58,24 +160,36 @@ Napi::Value GetMarshalNodes(const Napi::CallbackInfo &info,
   auto result = Array::New(env, node_count);
   setup_transfer_buffer(env, node_count);
   uint32_t *p = data->transfer_buffer;
+  if (tree->value_nodes_) {
+    uint32_t offset = 0;
+    for (unsigned i = 0; i < node_count; i++) {
+      TSNode node = nodes[i];
+      if (node.id == nullptr) {
+        result[i] = env.Null();
+      } else {
+        marshal_value_node(data, tree, node, offset++);
+        result[i] = Number::New(env, ts_node_symbol(node));
+      }
+    }
+    return result;
+  }
+
+  std::unordered_map<const void *, uint32_t> handles;
+  tree->node_cache_.BeginBatch();
   for (unsigned i = 0; i < node_count; i++) {
     TSNode node = nodes[i];
-    const auto &cache_entry = tree->cached_nodes_.find(node.id);
-    Napi::Value value;
-    if (cache_entry != tree->cached_nodes_.end() && (value = cache_entry->second->node.Value(), !value.IsEmpty())) {
-      result[i] = value;
+    if (node.id == nullptr) {
+      result[i] = env.Null();
     } else {
-      MarshalNodeId(node.id, p);
-      p += 2;
-      *(p++) = node.context[0];
-      *(p++) = node.context[1];
-      *(p++) = node.context[2];
-      *(p++) = node.context[3];
-      if (node.id != nullptr) {
-        result[i] = Number::New(env, ts_node_symbol(node));
-      } else {
-        result[i] = env.Null();
+      auto handle = handles.find(node.id);
+      if (handle == handles.end()) {
+        handle = handles.emplace(node.id, tree->FindOrAddNode(node)).first;
       }
+      if (tree->prefetch_geometry_) {
+        marshal_node_geometry(data, tree, node, static_cast<uint32_t>(p - data->transfer_buffer));
+      }
+      *(p++) = handle->second;
+      result[i] = Number::New(env, ts_node_symbol(node));
     }
   }
   return result;
@@ -84,87 +198,74 @@ Napi::Value GetMarshalNodes(const Napi::CallbackInfo &info,
 Napi::Value GetMarshalNode(const Napi::CallbackInfo &info, const Tree *tree, TSNode node) {
   Env env = info.Env();
   auto* data = env.GetInstanceData<AddonData>();
-  const auto &cache_entry = tree->cached_nodes_.find(node.id);
-  Napi::Value value;
-  if (cache_entry != tree->cached_nodes_.end() && (value = cache_entry->second->node.Value(), !value.IsEmpty())) {
-    return value;
-  } else {
-    setup_transfer_buffer(env, 1);
-    uint32_t *p = data->transfer_buffer;
-    MarshalNodeId(node.id, p);
-    p += 2;
-    *(p++) = node.context[0];
-    *(p++) = node.context[1];
-    *(p++) = node.context[2];
-    *(p++) = node.context[3];
-    if (node.id != nullptr) {
-      return Number::New(env, ts_node_symbol(node));
+  if (tree->value_nodes_) {
+    if (node.id == nullptr) {
+      data->transfer_buffer[0] = 0;
+      return env.Null();
     }
+    marshal_value_node(data, tree, node, 0);
+    return Number::New(env, ts_node_symbol(node));
   }
+
+  tree->node_cache_.BeginBatch();
+  if (node.id != nullptr) {
+    data->transfer_buffer[0] = tree->FindOrAddNode(node);
+    if (tree->prefetch_geometry_) {
+      marshal_node_geometry(data, tree, node, 0);
+    }
+    return Number::New(env, ts_node_symbol(node));
+  }
+  data->transfer_buffer[0] = 0;
   return env.Null();
 }
 
-TSNode UnmarshalNode(Napi::Env env, const Tree *tree, uint8_t offset) {
+TSNode UnmarshalNode(Napi::Env env, const Tree *tree, uint32_t offset) {
   auto* data = env.GetInstanceData<AddonData>();
-  TSNode result = {{0, 0, 0, 0}, nullptr, nullptr};
-  result.tree = tree->tree_;
-  if (result.tree == nullptr) {
+  if (tree == nullptr || tree->tree_ == nullptr) {
     throw TypeError::New(env, "Argument must be a tree");
   }
-
-  result.id = UnmarshalNodeId(&data->transfer_buffer[offset * FIELD_COUNT_PER_NODE]);
-  result.context[0] = data->transfer_buffer[offset * FIELD_COUNT_PER_NODE + 2];
-  result.context[1] = data->transfer_buffer[offset * FIELD_COUNT_PER_NODE + 3];
-  result.context[2] = data->transfer_buffer[offset * FIELD_COUNT_PER_NODE + 4];
-  result.context[3] = data->transfer_buffer[offset * FIELD_COUNT_PER_NODE + 5];
-  return result;
+  uint32_t handle = data->transfer_buffer[offset * FIELD_COUNT_PER_NODE];
+  if (handle == VALUE_NODE_HANDLE) {
+    return unmarshal_value_node(env, data, tree, offset);
+  }
+  return tree->GetNode(handle);
 }
 
-struct SymbolSet {
-  void add(TSSymbol symbol) { symbols.push_back(symbol); }
-  [[nodiscard]] bool contains(TSSymbol symbol) const { return std::find(symbols.begin(), symbols.end(), symbol) != symbols.end(); }
- private:
-  std::vector<TSSymbol> symbols;
-};
+LanguageIndex &language_index(Napi::Env env, const TSLanguage *language) {
+  auto *data = env.GetInstanceData<AddonData>();
+  std::unique_ptr<LanguageIndex> &index = data->language_indexes[language];
+  if (!index) {
+    index = std::make_unique<LanguageIndex>(language);
+  }
+  return *index;
+}
 
-void symbol_set_from_js(SymbolSet *symbols, const Napi::Value &value, const TSLanguage *language) {
+const SymbolSet &symbol_set_from_js(const Napi::Value &value, const TSLanguage *language) {
   Env env = value.Env();
 
   if (!value.IsArray()) {
     throw TypeError::New(env, "Argument must be a string or array of strings");
   }
 
-  unsigned symbol_count = ts_language_symbol_count(language);
-
+  std::string types;
   auto js_types = value.As<Array>();
   for (unsigned i = 0, n = js_types.Length(); i < n; i++) {
     Value js_node_type_value = js_types[i];
-    if (js_node_type_value.IsString()) {
-      auto js_node_type = js_node_type_value.As<String>();
-      std::string node_type = js_node_type.Utf8Value();
-
-      if (node_type == "ERROR") {
-        symbols->add(static_cast<TSSymbol>(-1));
-      } else {
-        for (TSSymbol j = 0; j < static_cast<TSSymbol>(symbol_count); j++) {
-          if (node_type == ts_language_symbol_name(language, j)) {
-            symbols->add(j);
-          }
-        }
-      }
-
-      continue;
+    if (!js_node_type_value.IsString()) {
+      throw TypeError::New(env, "Argument must be a string or array of strings");
     }
-
-    throw TypeError::New(env, "Argument must be a string or array of strings");
+    types += js_node_type_value.As<String>().Utf8Value();
+    types += '\0';
   }
+
+  return language_index(env, language).SymbolSetForTypes(types);
 }
 
 namespace {
 
 Napi::Value MarshalNullNode(Napi::Env env) {
   auto *data = env.GetInstanceData<AddonData>();
-  memset(data->transfer_buffer, 0, FIELD_COUNT_PER_NODE * sizeof(data->transfer_buffer[0]));
+  data->transfer_buffer[0] = 0;
   return env.Undefined();
 }
 
@@ -187,7 +288,7 @@ Napi::Value FirstNamedChildForIndex(const Napi::CallbackInfo &info) {
   const Tree *tree = Tree::UnwrapTree(info[0]);
   TSNode node = UnmarshalNode(env, tree);
   if (node.id != nullptr) {
-    Napi::Maybe<uint32_t> byte = ByteCountFromJS(info[1]);
+    Napi::Maybe<uint32_t> byte = ByteCountFromJS(info[1], tree->encoding_);
     if (byte.IsJust()) {
       return MarshalNode(info, tree, ts_node_first_named_child_for_byte(node, byte.Unwrap()));
     }
@@ -201,7 +302,7 @@ Napi::Value FirstChildForIndex(const Napi::CallbackInfo &info) {
   TSNode node = UnmarshalNode(env, tree);
 
   if ((node.id != nullptr) && info.Length() > 1) {
-    Napi::Maybe<uint32_t> byte = ByteCountFromJS(info[1]);
+    Napi::Maybe<uint32_t> byte = ByteCountFromJS(info[1], tree->encoding_);
     if (byte.IsJust()) {
       return MarshalNode(info, tree, ts_node_first_child_for_byte(node, byte.Unwrap()));
     }
@@ -215,8 +316,8 @@ Napi::Value NamedDescendantForIndex(const Napi::CallbackInfo &info) {
   TSNode node = UnmarshalNode(env, tree);
 
   if (node.id != nullptr) {
-    Napi::Maybe<uint32_t> maybe_min = ByteCountFromJS(info[1]);
-    Napi::Maybe<uint32_t> maybe_max = ByteCountFromJS(info[2]);
+    Napi::Maybe<uint32_t> maybe_min = ByteCountFromJS(info[1], tree->encoding_);
+    Napi::Maybe<uint32_t> maybe_max = ByteCountFromJS(info[2], tree->encoding_);
     if (maybe_min.IsJust() && maybe_max.IsJust()) {
       uint32_t min = maybe_min.Unwrap();
       uint32_t max = maybe_max.Unwrap();
@@ -232,8 +333,8 @@ Napi::Value DescendantForIndex(const Napi::CallbackInfo &info) {
   TSNode node = UnmarshalNode(env, tree);
 
   if (node.id != nullptr) {
-    Napi::Maybe<uint32_t> maybe_min = ByteCountFromJS(info[1]);
-    Napi::Maybe<uint32_t> maybe_max = ByteCountFromJS(info[2]);
+    Napi::Maybe<uint32_t> maybe_min = ByteCountFromJS(info[1], tree->encoding_);
+    Napi::Maybe<uint32_t> maybe_max = ByteCountFromJS(info[2], tree->encoding_);
     if (maybe_min.IsJust() && maybe_max.IsJust()) {
       uint32_t min = maybe_min.Unwrap();
       uint32_t max = maybe_max.Unwrap();
@@ -249,8 +350,8 @@ Napi::Value NamedDescendantForPosition(const Napi::CallbackInfo &info) {
   TSNode node = UnmarshalNode(env, tree);
 
   if (node.id != nullptr) {
-    Napi::Maybe<TSPoint> maybe_min = PointFromJS(info[1]);
-    Napi::Maybe<TSPoint> maybe_max = PointFromJS(info[2]);
+    Napi::Maybe<TSPoint> maybe_min = PointFromJS(info[1], tree->encoding_);
+    Napi::Maybe<TSPoint> maybe_max = PointFromJS(info[2], tree->encoding_);
     if (maybe_min.IsJust() && maybe_max.IsJust()) {
       TSPoint min = maybe_min.Unwrap();
       TSPoint max = maybe_max.Unwrap();
@@ -266,8 +367,8 @@ Napi::Value DescendantForPosition(const Napi::CallbackInfo &info) {
   TSNode node = UnmarshalNode(env, tree);
 
   if (node.id != nullptr) {
-    Napi::Maybe<TSPoint> maybe_min = PointFromJS(info[1]);
-    Napi::Maybe<TSPoint> maybe_max = PointFromJS(info[2]);
+    Napi::Maybe<TSPoint> maybe_min = PointFromJS(info[1], tree->encoding_);
+    Napi::Maybe<TSPoint> maybe_max = PointFromJS(info[2], tree->encoding_);
     if (maybe_min.IsJust() && maybe_max.IsJust()) {
       TSPoint min = maybe_min.Unwrap();
       TSPoint max = maybe_max.Unwrap();
@@ -319,7 +420,7 @@ Napi::Value Type(const Napi::CallbackInfo &info) {
   TSNode node = UnmarshalNode(env, tree);
 
   if (node.id != nullptr) {
-    return String::New(env, ts_node_type(node));
+    return NameToJS(env, ts_node_type(node));
   }
 
   return env.Undefined();
@@ -331,7 +432,7 @@ Napi::Value GrammarType(const Napi::CallbackInfo &info) {
   TSNode node = UnmarshalNode(env, tree);
 
   if (node.id != nullptr) {
-    return String::New(env, ts_node_grammar_type(node));
+    return NameToJS(env, ts_node_grammar_type(node));
   }
 
   return env.Undefined();
@@ -435,8 +536,7 @@ Napi::Value StartIndex(const Napi::CallbackInfo &info) {
   TSNode node = UnmarshalNode(env, tree);
 
   if (node.id != nullptr) {
-    auto result = static_cast<int32_t>(ts_node_start_byte(node) / 2);
-    return Number::New(env, result);
+    return ByteCountToJS(env, ts_node_start_byte(node), tree->encoding_);
   }
 
   return env.Undefined();
@@ -448,8 +548,7 @@ Napi::Value EndIndex(const Napi::CallbackInfo &info) {
   TSNode node = UnmarshalNode(env, tree);
 
   if (node.id != nullptr) {
-    auto result = static_cast<int32_t>(ts_node_end_byte(node) / 2);
-    return Number::New(env, result);
+    return ByteCountToJS(env, ts_node_end_byte(node), tree->encoding_);
   }
 
   return env.Undefined();
@@ -461,7 +560,7 @@ Napi::Value StartPosition(const Napi::CallbackInfo &info) {
   TSNode node = UnmarshalNode(env, tree);
 
   if (node.id != nullptr) {
-    TransferPoint(env, ts_node_start_point(node));
+    TransferPoint(env, ts_node_start_point(node), tree->encoding_);
   }
 
   return env.Undefined();
@@ -473,7 +572,7 @@ Napi::Value EndPosition(const Napi::CallbackInfo &info) {
   TSNode node = UnmarshalNode(env, tree);
 
   if (node.id != nullptr) {
-    TransferPoint(env, ts_node_end_point(node));
+    TransferPoint(env, ts_node_end_point(node), tree->encoding_);
   }
 
   return env.Undefined();
@@ -574,7 +673,7 @@ Napi::Value FieldNameForChild(const Napi::CallbackInfo &info) {
     uint32_t child_id = info[1].As<Number>().Uint32Value();
     const char *field_name = ts_node_field_name_for_child(node, child_id);
     if (field_name != nullptr) {
-      return String::New(env, field_name);
+      return NameToJS(env, field_name);
     }
   }
   return env.Undefined();
@@ -591,7 +690,7 @@ Napi::Value FieldNameForNamedChild(const Napi::CallbackInfo &info) {
     uint32_t child_id = info[1].As<Number>().Uint32Value();
     const char *field_name = ts_node_field_name_for_named_child(node, child_id);
     if (field_name != nullptr) {
-      return String::New(env, field_name);
+      return NameToJS(env, field_name);
     }
   }
   return env.Undefined();
@@ -658,7 +757,7 @@ Napi::Value ChildrenForFieldName(const Napi::CallbackInfo &info) {
   TSTreeCursor cursor = ts_tree_cursor_new(node);
 
   const TSLanguage *language = ts_tree_language(node.tree);
-  TSFieldId field_id = ts_language_field_id_for_name(language, field_name.c_str(), field_name.length());
+  TSFieldId field_id = language_index(env, language).FieldIdForName(field_name);
 
   bool done = field_id == 0;
   if (!done) {
@@ -857,14 +956,13 @@ Napi::Value DescendantsOfType(const Napi::CallbackInfo &info) {
     return env.Undefined();
   }
 
-  SymbolSet symbols;
-  symbol_set_from_js(&symbols, info[1], ts_tree_language(node.tree));
+  const SymbolSet &symbols = symbol_set_from_js(info[1], ts_tree_language(node.tree));
 
   TSPoint start_point = {0, 0};
   TSPoint end_point = {UINT32_MAX, UINT32_MAX};
 
   if (info.Length() > 2 && info[2].IsObject()) {
-    auto maybe_start_point = PointFromJS(info[2]);
+    auto maybe_start_point = PointFromJS(info[2], tree->encoding_);
     if (maybe_start_point.IsNothing()) {
       return env.Undefined();
     }
@@ -872,7 +970,7 @@ Napi::Value DescendantsOfType(const Napi::CallbackInfo &info) {
   }
 
   if (info.Length() > 3 && info[3].IsObject()) {
-    auto maybe_end_point = PointFromJS(info[3]);
+    auto maybe_end_point = PointFromJS(info[3], tree->encoding_);
     if (maybe_end_point.IsNothing()) {
       return env.Undefined();
     }
@@ -983,8 +1081,7 @@ Napi::Value Closest(const Napi::CallbackInfo &info) {
     return env.Undefined();
   }
 
-  SymbolSet symbols;
-  symbol_set_from_js(&symbols, info[1], ts_tree_language(node.tree));
+  const SymbolSet &symbols = symbol_set_from_js(info[1], ts_tree_language(node.tree));
 
   for (;;) {
     TSNode parent = ts_node_parent(node);
@@ -1000,12 +1097,149 @@ Napi::Value Closest(const Napi::CallbackInfo &info) {
   return MarshalNullNode(env);
 }
 
+// A list of nodes passed to native code in one call, as their handles along
+// with the fields of any value nodes.
+class NodeList {
+ public:
+  NodeList(const Tree *tree, const Napi::Value &js_handles, const Napi::Value &js_values) : tree_(tree) {
+    Env env = js_handles.Env();
+    if (tree == nullptr || tree->tree_ == nullptr) {
+      throw TypeError::New(env, "Argument must be a tree");
+    }
+    if (!js_handles.IsTypedArray() || js_handles.As<TypedArray>().TypedArrayType() != napi_uint32_array) {
+      throw TypeError::New(env, "Handles must be a Uint32Array");
+    }
+    handles_ = js_handles.As<Uint32Array>().Data();
+    size_ = js_handles.As<Uint32Array>().ElementLength();
+
+    if (js_values.IsTypedArray() && js_values.As<TypedArray>().TypedArrayType() == napi_uint32_array) {
+      if (js_values.As<Uint32Array>().ElementLength() < size_ * FIELD_COUNT_PER_VALUE_NODE) {
+        throw RangeError::New(env, "Value node fields are too short");
+      }
+      values_ = js_values.As<Uint32Array>().Data();
+    }
+  }
+
+  size_t Size() const { return size_; }
+
+  TSNode Get(Napi::Env env, size_t index) const {
+    TSNode node;
+    if (handles_[index] == VALUE_NODE_HANDLE) {
+      if (values_ == nullptr) {
+        throw TypeError::New(env, "Missing value node fields");
+      }
+      node = value_node_from_fields(env, tree_, &values_[index * FIELD_COUNT_PER_VALUE_NODE]);
+    } else {
+      node = tree_->GetNode(handles_[index]);
+    }
+    if (node.id == nullptr) {
+      throw TypeError::New(env, "Nodes must belong to the tree");
+    }
+    return node;
+  }
+
+ private:
+  const Tree *tree_;
+  const uint32_t *handles_ = nullptr;
+  const uint32_t *values_ = nullptr;
+  size_t size_ = 0;
+};
+
+// The text of a node, sliced from its tree's retained source.
+Napi::Value node_text(Napi::Env env, const Tree *tree, TSNode node) {
+  const SourceFile &source = *tree->source_;
+  size_t start = std::min<size_t>(ts_node_start_byte(node), source.Size());
+  size_t end = std::min<size_t>(std::max<size_t>(ts_node_end_byte(node), start), source.Size());
+  const char *data = source.Data() + start;
+  if (tree->encoding_ == TSInputEncodingUTF8) {
+    return String::New(env, data, end - start);
+  }
+  return String::New(env, reinterpret_cast<const char16_t *>(data), (end - start) / 2);
+}
+
+// Fill caller-supplied Uint32Arrays with attributes of many nodes at once.
+// Only the attributes in the field mask are computed.
+Napi::Value BulkAttributes(const Napi::CallbackInfo &info) {
+  Env env = info.Env();
+  const Tree *tree = Tree::UnwrapTree(info[0]);
+  NodeList nodes(tree, info[1], info[2]);
+  size_t node_count = nodes.Size();
+
+  uint32_t field_mask = info[3].As<Number>().Uint32Value();
+  auto js_outputs = info[4].As<Array>();
+  uint32_t *outputs[kAttributeCount] = {};
+  for (uint32_t i = 0; i < kAttributeCount; i++) {
+    if ((field_mask & (1U << i)) == 0) {
+      continue;
+    }
+    Napi::Value js_output = js_outputs[i];
+    if (!js_output.IsTypedArray() || js_output.As<TypedArray>().TypedArrayType() != napi_uint32_array) {
+      throw TypeError::New(env, "Outputs must be Uint32Arrays");
+    }
+    if (js_output.As<Uint32Array>().ElementLength() < node_count) {
+      throw RangeError::New(env, "Output is shorter than the list of nodes");
+    }
+    outputs[i] = js_output.As<Uint32Array>().Data();
+  }
+
+  uint32_t bytes_per_character = BytesPerCharacter(tree->encoding_);
+  bool needs_start_point = outputs[kStartRowAttribute] || outputs[kStartColumnAttribute];
+  bool needs_end_point = outputs[kEndRowAttribute] || outputs[kEndColumnAttribute];
+  for (size_t i = 0; i < node_count; i++) {
+    TSNode node = nodes.Get(env, i);
+    if (outputs[kTypeIdAttribute]) outputs[kTypeIdAttribute][i] = ts_node_symbol(node);
+    if (outputs[kStartIndexAttribute]) outputs[kStartIndexAttribute][i] = ts_node_start_byte(node) / bytes_per_character;
+    if (outputs[kEndIndexAttribute]) outputs[kEndIndexAttribute][i] = ts_node_end_byte(node) / bytes_per_character;
+    if (needs_start_point) {
+      TSPoint point = ts_node_start_point(node);
+      if (outputs[kStartRowAttribute]) outputs[kStartRowAttribute][i] = point.row;
+      if (outputs[kStartColumnAttribute]) outputs[kStartColumnAttribute][i] = point.column / bytes_per_character;
+    }
+    if (needs_end_point) {
+      TSPoint point = ts_node_end_point(node);
+      if (outputs[kEndRowAttribute]) outputs[kEndRowAttribute][i] = point.row;
+      if (outputs[kEndColumnAttribute]) outputs[kEndColumnAttribute][i] = point.column / bytes_per_character;
+    }
+    if (outputs[kFlagsAttribute]) outputs[kFlagsAttribute][i] = node_flags(node);
+  }
+
+  return env.Undefined();
+}
+
+Napi::Value Text(const Napi::CallbackInfo &info) {
+  Env env = info.Env();
+  const Tree *tree = Tree::UnwrapTree(info[0]);
+  TSNode node = UnmarshalNode(env, tree);
+
+  if (node.id != nullptr && tree->source_) {
+    return node_text(env, tree, node);
+  }
+
+  return env.Undefined();
+}
+
+// The texts of many nodes of a tree that retains its source.
+Napi::Value Texts(const Napi::CallbackInfo &info) {
+  Env env = info.Env();
+  const Tree *tree = Tree::UnwrapTree(info[0]);
+  NodeList nodes(tree, info[1], info[2]);
+  if (!tree->source_) {
+    throw TypeError::New(env, "The tree doesn't retain its source");
+  }
+
+  auto result = Array::New(env, nodes.Size());
+  for (size_t i = 0; i < nodes.Size(); i++) {
+    result[i] = node_text(env, tree, nodes.Get(env, i));
+  }
+  return result;
+}
+
 Napi::Value Walk(const Napi::CallbackInfo &info) {
   Env env = info.Env();
   const Tree *tree = Tree::UnwrapTree(info[0]);
   TSNode node = UnmarshalNode(env, tree);
   TSTreeCursor cursor = ts_tree_cursor_new(node);
-  return TreeCursor::NewInstance(env, cursor);
+  return TreeCursor::NewInstance(env, cursor, tree->encoding_);
 }
 
 } // namespace
@@ -1073,6 +1307,9 @@ void Init(Napi::Env env, Napi::Object exports) {
     {"closest", Closest},
     {"childNodeForFieldId", ChildNodeForFieldId},
     {"childNodesForFieldId", ChildNodesForFieldId},
+    {"bulkAttributes", BulkAttributes},
+    {"text", Text},
+    {"texts", Texts},
   };
 
   for (auto & method : methods) {
@@ -1080,7 +1317,8 @@ void Init(Napi::Env env, Napi::Object exports) {
   }
 
   data->module_exports = Napi::Persistent(exports);
-  setup_transfer_buffer(env, 1);
+  // Room for the two nodes that `childWithDescendant` takes.
+  setup_transfer_buffer(env, 2);
 
   exports["NodeMethods"] = result;
 }
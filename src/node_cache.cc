@@ -0,0 +1,244 @@
+#include "./node_cache.h"
+#include "./addon_data.h"
+
+#include <algorithm>
+#include <napi.h>
+
+using namespace Napi;
+
+namespace node_tree_sitter {
+
+namespace {
+
+const size_t kInitialIndexSize = 64;
+
+} // namespace
+
+NodeCache::NodeCache() : index_(kInitialIndexSize, IndexEntry{nullptr, 0}) {
+  slots_.emplace_back();
+  slots_[0].used = false;
+}
+
+uint32_t NodeCache::FindOrAdd(TSNode node, size_t version) {
+  uint32_t handle = IndexFind(node.id);
+  if (handle != 0) {
+    slots_[handle].batch = batch_;
+    return handle;
+  }
+  return Add(node, version);
+}
+
+uint32_t NodeCache::Add(TSNode node, size_t version) {
+  if (free_handles_.empty() && live_count_ >= sweep_threshold_) {
+    Sweep();
+  }
+
+  uint32_t handle;
+  if (free_handles_.empty()) {
+    handle = slots_.size();
+    slots_.emplace_back();
+  } else {
+    handle = free_handles_.back();
+    free_handles_.pop_back();
+  }
+
+  Slot &slot = slots_[handle];
+  slot.node = node;
+  slot.version = version;
+  slot.batch = batch_;
+  slot.used = true;
+  slot.indexed = false;
+  slot.has_object = false;
+  live_count_++;
+  return handle;
+}
+
+// An object that replaces a collected one keeps the slot and its index entry.
+void NodeCache::SetObject(uint32_t handle) {
+  Slot *slot = Get(handle);
+  if (slot == nullptr || slot->has_object) {
+    return;
+  }
+  slot->has_object = true;
+  IndexInsert(slot->node.id, handle);
+  slot->indexed = true;
+  if (indexed_count_ > max_indexed_) {
+    Evict();
+  }
+}
+
+Napi::Array NodeCache::Objects(Napi::Env env) {
+  if (objects_.IsEmpty()) {
+    objects_ = Napi::Persistent(Napi::Array::New(env));
+  }
+  return objects_.Value();
+}
+
+void NodeCache::SetMaxIndexed(size_t max_indexed) {
+  max_indexed_ = max_indexed;
+  if (indexed_count_ > max_indexed_) {
+    Evict();
+  }
+}
+
+Napi::Object NodeCache::Stats(Napi::Env env) const {
+  Object result = Object::New(env);
+  result["nodes"] = Number::New(env, static_cast<double>(live_count_));
+  result["indexed"] = Number::New(env, static_cast<double>(indexed_count_));
+  result["maxIndexed"] = max_indexed_ == SIZE_MAX ? env.Null() : Napi::Value(Number::New(env, static_cast<double>(max_indexed_)));
+  result["sweeps"] = Number::New(env, static_cast<double>(sweeps_));
+  result["evictions"] = Number::New(env, static_cast<double>(evictions_));
+  return result;
+}
+
+// Slots whose objects have been collected are reclaimed first, so that they
+// don't hold back the tree's edit log.
+size_t NodeCache::OldestVersion(size_t current) {
+  Sweep();
+  size_t oldest = current;
+  for (const Slot &slot : slots_) {
+    if (slot.used) {
+      oldest = std::min(oldest, slot.version);
+    }
+  }
+  return oldest;
+}
+
+// Reclaim the slots whose objects have been collected, and the slots from
+// earlier batches that were never given an object.
+void NodeCache::Sweep() {
+  sweeps_++;
+  Napi::Array objects;
+  Napi::Function deref;
+  if (!objects_.IsEmpty()) {
+    objects = objects_.Value();
+    deref = objects.Env().GetInstanceData<AddonData>()->weak_ref_deref.Value();
+  }
+  for (uint32_t handle = 1; handle < slots_.size(); handle++) {
+    Slot &slot = slots_[handle];
+    if (!slot.used || slot.batch == batch_) {
+      continue;
+    }
+    if (!slot.has_object) {
+      Release(handle);
+    } else if (deref.Call(objects.Get(handle), {}).IsUndefined()) {
+      objects.Set(handle, objects.Env().Undefined());
+      Release(handle);
+    }
+  }
+  sweep_threshold_ = std::max(kMinSweepThreshold, 2 * live_count_);
+}
+
+void NodeCache::Release(uint32_t handle) {
+  Slot &slot = slots_[handle];
+  if (slot.indexed) {
+    IndexErase(slot.node.id, handle);
+  }
+  slot.used = false;
+  slot.indexed = false;
+  free_handles_.push_back(handle);
+  live_count_--;
+}
+
+// Remove the oldest index entries, in slot order, until the index is within
+// its cap. The slots themselves stay until their objects are collected.
+void NodeCache::Evict() {
+  while (indexed_count_ > max_indexed_) {
+    if (evict_cursor_ >= slots_.size()) {
+      evict_cursor_ = 1;
+    }
+    Slot &slot = slots_[evict_cursor_];
+    if (slot.used && slot.indexed) {
+      IndexErase(slot.node.id, evict_cursor_);
+      slot.indexed = false;
+      evictions_++;
+    }
+    evict_cursor_++;
+  }
+}
+
+// Node ids are pointers to subtrees, so the low bits carry no information.
+size_t NodeCache::Bucket(const void *id) const {
+  auto key = reinterpret_cast<uintptr_t>(id);
+  return static_cast<size_t>((key >> 3) * 0x9E3779B97F4A7C15ULL) & (index_.size() - 1);
+}
+
+uint32_t NodeCache::IndexFind(const void *id) const {
+  size_t mask = index_.size() - 1;
+  for (size_t i = Bucket(id);; i = (i + 1) & mask) {
+    const IndexEntry &entry = index_[i];
+    if (entry.id == id) {
+      return entry.handle;
+    }
+    if (entry.id == nullptr) {
+      return 0;
+    }
+  }
+}
+
+// A newer object for a node replaces an evicted or collected one.
+void NodeCache::IndexInsert(const void *id, uint32_t handle) {
+  if ((indexed_count_ + 1) * 4 > index_.size() * 3) {
+    IndexGrow();
+  }
+  size_t mask = index_.size() - 1;
+  for (size_t i = Bucket(id);; i = (i + 1) & mask) {
+    IndexEntry &entry = index_[i];
+    if (entry.id == id) {
+      slots_[entry.handle].indexed = false;
+      entry.handle = handle;
+      return;
+    }
+    if (entry.id == nullptr) {
+      entry = {id, handle};
+      indexed_count_++;
+      return;
+    }
+  }
+}
+
+// Erase with backward shifting, so that probe sequences never need tombstones.
+void NodeCache::IndexErase(const void *id, uint32_t handle) {
+  size_t mask = index_.size() - 1;
+  size_t i = Bucket(id);
+  while (index_[i].id != id) {
+    if (index_[i].id == nullptr) {
+      return;
+    }
+    i = (i + 1) & mask;
+  }
+  if (index_[i].handle != handle) {
+    return;
+  }
+
+  indexed_count_--;
+  for (size_t j = (i + 1) & mask;; j = (j + 1) & mask) {
+    if (index_[j].id == nullptr) {
+      break;
+    }
+    size_t home = Bucket(index_[j].id);
+    // Move the entry back if its home bucket isn't in the cyclic range (i, j].
+    if ((j > i && (home <= i || home > j)) || (j < i && home <= i && home > j)) {
+      index_[i] = index_[j];
+      i = j;
+    }
+  }
+  index_[i] = {nullptr, 0};
+}
+
+void NodeCache::IndexGrow() {
+  std::vector<IndexEntry> old_index(index_.size() * 2, IndexEntry{nullptr, 0});
+  index_.swap(old_index);
+  size_t mask = index_.size() - 1;
+  for (const IndexEntry &entry : old_index) {
+    if (entry.id != nullptr) {
+      size_t i = Bucket(entry.id);
+      while (index_[i].id != nullptr) {
+        i = (i + 1) & mask;
+      }
+      index_[i] = entry;
+    }
+  }
+}
+
+} // namespace node_tree_sitter
@@ -0,0 +1,107 @@
+#ifndef NODE_TREE_SITTER_NODE_CACHE_H_
+#define NODE_TREE_SITTER_NODE_CACHE_H_
+
+#include "tree_sitter/api.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <napi.h>
+#include <vector>
+
+namespace node_tree_sitter {
+
+// The nodes of one tree that JS holds, stored in a slab and indexed by handle.
+// Handle 0 is never used, so that it can stand for a null node.
+//
+// Nodes that already have a JS object are found through an open-addressing
+// index keyed by node id, so that the same node is always the same object.
+// The objects themselves are held by a single JS array of WeakRefs, indexed by
+// handle, which JS reads before creating a node. No native reference or
+// finalizer is attached to any node. Instead, once the slab reaches its sweep
+// threshold, the slots whose objects have been collected are reclaimed in one
+// pass over the array, and the threshold grows with the number of live nodes
+// so that sweeps stay amortized.
+//
+// The index can be capped. Past the cap, the oldest entries are evicted from
+// the index, but not from the slab, so their objects keep working; a later
+// lookup of an evicted node creates a second object for it.
+class NodeCache final {
+ public:
+  struct Slot {
+    TSNode node;
+    // How many of the tree's edits have been applied to the node.
+    size_t version;
+    // The last batch that the slot was handed out in. Slots are only
+    // reclaimed by sweeps after that batch, so that a handle is never handed
+    // out for two nodes at once.
+    uint32_t batch;
+    bool used;
+    bool indexed;
+    bool has_object;
+  };
+
+  NodeCache();
+
+  // Start handing out the handles for one call into native code.
+  void BeginBatch() { batch_++; }
+
+  // The handle of a node that has been given an object, whose object JS
+  // reuses if it hasn't been collected, or else a new handle.
+  uint32_t FindOrAdd(TSNode node, size_t version);
+  // Record that JS has stored an object for a handle in the array of objects.
+  void SetObject(uint32_t handle);
+
+  // The WeakRefs to the nodes' objects, by handle, created on first use.
+  Napi::Array Objects(Napi::Env env);
+
+  Slot *Get(uint32_t handle) {
+    if (handle == 0 || handle >= slots_.size() || !slots_[handle].used) {
+      return nullptr;
+    }
+    return &slots_[handle];
+  }
+
+  void SetMaxIndexed(size_t max_indexed);
+  Napi::Object Stats(Napi::Env env) const;
+
+  // The oldest edit version of any live node, or `current` if there are none.
+  size_t OldestVersion(size_t current);
+
+ private:
+  struct IndexEntry {
+    const void *id;
+    uint32_t handle;
+  };
+
+  static const size_t kMinSweepThreshold = 1024;
+
+  size_t Bucket(const void *id) const;
+  uint32_t IndexFind(const void *id) const;
+  void IndexInsert(const void *id, uint32_t handle);
+  void IndexErase(const void *id, uint32_t handle);
+  void IndexGrow();
+
+  uint32_t Add(TSNode node, size_t version);
+  void Sweep();
+  void Release(uint32_t handle);
+  void Evict();
+
+  std::vector<Slot> slots_;
+  Napi::Reference<Napi::Array> objects_;
+  std::vector<uint32_t> free_handles_;
+  size_t live_count_ = 0;
+  size_t sweep_threshold_ = kMinSweepThreshold;
+  uint32_t batch_ = 0;
+
+  std::vector<IndexEntry> index_;
+  size_t indexed_count_ = 0;
+  size_t max_indexed_ = SIZE_MAX;
+  size_t evict_cursor_ = 1;
+
+  uint64_t sweeps_ = 0;
+  uint64_t evictions_ = 0;
+};
+
+} // namespace node_tree_sitter
+
+#endif // NODE_TREE_SITTER_NODE_CACHE_H_
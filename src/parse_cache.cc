@@ -0,0 +1,252 @@
+#include "./parse_cache.h"
+#include "./text_input.h"
+
+#include <cmath>
+#include <cstring>
+#include <napi.h>
+
+using namespace Napi;
+
+namespace node_tree_sitter {
+
+/*
+  tstag parse_cache # => 0x3104A1ECAD324F10, 0xB0BB9819F87A823A
+*/
+const napi_type_tag PARSE_CACHE_TYPE_TAG = {
+  0x3104A1ECAD324F10, 0xB0BB9819F87A823A
+};
+
+namespace {
+
+const size_t kDefaultMaxBytes = 64 * 1024 * 1024;
+// Number.MAX_SAFE_INTEGER, past which a JS number isn't an exact byte count.
+const double kMaxSafeInteger = 9007199254740991.0;
+
+// A rough lower bound on the heap size of a node in a tree, used to estimate
+// how much memory a cached tree keeps alive.
+const size_t kApproximateNodeBytes = 32;
+
+// XXH64, by Yann Collet.
+const uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+const uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+const uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+const uint64_t kPrime5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t rotate_left(uint64_t value, int bits) {
+  return (value << bits) | (value >> (64 - bits));
+}
+
+inline uint64_t read64(const uint8_t *data) {
+  uint64_t result;
+  std::memcpy(&result, data, sizeof(result));
+  return result;
+}
+
+inline uint32_t read32(const uint8_t *data) {
+  uint32_t result;
+  std::memcpy(&result, data, sizeof(result));
+  return result;
+}
+
+inline uint64_t accumulate(uint64_t accumulator, uint64_t input) {
+  accumulator += input * kPrime2;
+  accumulator = rotate_left(accumulator, 31);
+  return accumulator * kPrime1;
+}
+
+inline uint64_t merge_round(uint64_t accumulator, uint64_t value) {
+  accumulator ^= accumulate(0, value);
+  return accumulator * kPrime1 + kPrime4;
+}
+
+uint64_t hash_bytes(const void *bytes, size_t length, uint64_t seed) {
+  const auto *data = static_cast<const uint8_t *>(bytes);
+  const uint8_t *end = data + length;
+  uint64_t hash;
+
+  if (length >= 32) {
+    uint64_t v1 = seed + kPrime1 + kPrime2;
+    uint64_t v2 = seed + kPrime2;
+    uint64_t v3 = seed;
+    uint64_t v4 = seed - kPrime1;
+    do {
+      v1 = accumulate(v1, read64(data));
+      v2 = accumulate(v2, read64(data + 8));
+      v3 = accumulate(v3, read64(data + 16));
+      v4 = accumulate(v4, read64(data + 24));
+      data += 32;
+    } while (data <= end - 32);
+    hash = rotate_left(v1, 1) + rotate_left(v2, 7) + rotate_left(v3, 12) + rotate_left(v4, 18);
+    hash = merge_round(hash, v1);
+    hash = merge_round(hash, v2);
+    hash = merge_round(hash, v3);
+    hash = merge_round(hash, v4);
+  } else {
+    hash = seed + kPrime5;
+  }
+
+  hash += length;
+  while (data + 8 <= end) {
+    hash ^= accumulate(0, read64(data));
+    hash = rotate_left(hash, 27) * kPrime1 + kPrime4;
+    data += 8;
+  }
+  if (data + 4 <= end) {
+    hash ^= static_cast<uint64_t>(read32(data)) * kPrime1;
+    hash = rotate_left(hash, 23) * kPrime2 + kPrime3;
+    data += 4;
+  }
+  while (data < end) {
+    hash ^= *data * kPrime5;
+    hash = rotate_left(hash, 11) * kPrime1;
+    data++;
+  }
+
+  hash ^= hash >> 33;
+  hash *= kPrime2;
+  hash ^= hash >> 29;
+  hash *= kPrime3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+} // namespace
+
+void ParseCache::Init(Napi::Env env, Napi::Object exports) {
+  Function ctor = DefineClass(env, "ParseCache", {
+    InstanceMethod("getStats", &ParseCache::GetStats, napi_default_method),
+    InstanceMethod("clear", &ParseCache::Clear, napi_default_method),
+  });
+
+  exports["ParseCache"] = ctor;
+}
+
+ParseCache *ParseCache::UnwrapCache(const Napi::Value &value) {
+  if (!value.IsObject()) {
+    return nullptr;
+  }
+  auto js_cache = value.As<Object>();
+  if (!js_cache.CheckTypeTag(&PARSE_CACHE_TYPE_TAG)) {
+    return nullptr;
+  }
+  return ParseCache::Unwrap(js_cache);
+}
+
+ParseCache::Key ParseCache::KeyFor(const TSParser *parser, const TextInput &input) {
+  uint32_t range_count;
+  const TSRange *ranges = ts_parser_included_ranges(parser, &range_count);
+  uint64_t seed = hash_bytes(ranges, range_count * sizeof(TSRange), input.Encoding());
+
+  Key key;
+  key.hash = hash_bytes(input.Data(), input.Length(), seed);
+  key.length = input.Length();
+  key.language = ts_parser_language(parser);
+  key.encoding = input.Encoding();
+  return key;
+}
+
+ParseCache::ParseCache(const Napi::CallbackInfo &info)
+  : Napi::ObjectWrap<ParseCache>(info), max_bytes_(kDefaultMaxBytes) {
+  Value().TypeTag(&PARSE_CACHE_TYPE_TAG);
+  if (info[0].IsNumber()) {
+    double max_bytes = info[0].As<Number>().DoubleValue();
+    if (max_bytes != std::floor(max_bytes) || max_bytes < 0 || max_bytes > kMaxSafeInteger) {
+      throw RangeError::New(info.Env(), "Maximum size must be a non-negative integer");
+    }
+    max_bytes_ = static_cast<size_t>(max_bytes);
+  } else if (!info[0].IsUndefined()) {
+    throw TypeError::New(info.Env(), "Maximum size must be a number of bytes");
+  }
+}
+
+ParseCache::~ParseCache() {
+  for (Entry &entry : entries_) {
+    ts_tree_delete(entry.tree);
+  }
+}
+
+bool ParseCache::Entry::Matches(const TSParser *parser, const TextInput &input) const {
+  uint32_t range_count;
+  const TSRange *parser_ranges = ts_parser_included_ranges(parser, &range_count);
+  return text.size() == input.Length() &&
+    std::memcmp(text.data(), input.Data(), text.size()) == 0 &&
+    ranges.size() == range_count &&
+    std::memcmp(ranges.data(), parser_ranges, range_count * sizeof(TSRange)) == 0;
+}
+
+TSTree *ParseCache::Get(const Key &key, const TSParser *parser, const TextInput &input) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found = index_.find(key);
+  if (found == index_.end() || !found->second->Matches(parser, input)) {
+    misses_++;
+    return nullptr;
+  }
+  hits_++;
+  entries_.splice(entries_.begin(), entries_, found->second);
+  return ts_tree_copy(found->second->tree);
+}
+
+void ParseCache::Put(const Key &key, const TSParser *parser, const TextInput &input, const TSTree *tree) {
+  uint32_t range_count;
+  const TSRange *ranges = ts_parser_included_ranges(parser, &range_count);
+  size_t bytes = key.length + range_count * sizeof(TSRange) +
+    ts_node_descendant_count(ts_tree_root_node(tree)) * kApproximateNodeBytes;
+  if (bytes > max_bytes_) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (index_.count(key) > 0) {
+    return;
+  }
+  Evict(bytes);
+  entries_.push_front({
+    key,
+    std::string(input.Data(), input.Length()),
+    std::vector<TSRange>(ranges, ranges + range_count),
+    ts_tree_copy(tree),
+    bytes,
+  });
+  index_.emplace(key, entries_.begin());
+  bytes_ += bytes;
+}
+
+// Drop the least recently used trees until there is room for `needed` bytes.
+void ParseCache::Evict(size_t needed) {
+  while (!entries_.empty() && bytes_ + needed > max_bytes_) {
+    Entry &entry = entries_.back();
+    bytes_ -= entry.bytes;
+    index_.erase(entry.key);
+    ts_tree_delete(entry.tree);
+    entries_.pop_back();
+    evictions_++;
+  }
+}
+
+Napi::Value ParseCache::GetStats(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+  Object result = Object::New(env);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  result["hits"] = Number::New(env, static_cast<double>(hits_));
+  result["misses"] = Number::New(env, static_cast<double>(misses_));
+  result["evictions"] = Number::New(env, static_cast<double>(evictions_));
+  result["entries"] = Number::New(env, static_cast<double>(entries_.size()));
+  result["bytes"] = Number::New(env, static_cast<double>(bytes_));
+  result["maxBytes"] = Number::New(env, static_cast<double>(max_bytes_));
+  return result;
+}
+
+Napi::Value ParseCache::Clear(const Napi::CallbackInfo &info) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (Entry &entry : entries_) {
+    ts_tree_delete(entry.tree);
+  }
+  entries_.clear();
+  index_.clear();
+  bytes_ = 0;
+  return info.This();
+}
+
+} // namespace node_tree_sitter
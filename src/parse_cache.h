@@ -0,0 +1,85 @@
+#ifndef NODE_TREE_SITTER_PARSE_CACHE_H_
+#define NODE_TREE_SITTER_PARSE_CACHE_H_
+
+#include "tree_sitter/api.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <napi.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace node_tree_sitter {
+
+class TextInput;
+
+// Trees keyed by a hash of the text they were parsed from, together with the
+// parser's language, included ranges and input encoding. Each entry keeps a
+// copy of its text and ranges, which are compared on lookup so that a hash
+// collision is treated as a miss. A hit hands out a copy of the cached tree,
+// which shares all of its nodes. Entries are evicted
+// in least-recently-used order once their approximate size exceeds the budget.
+// Lookups may happen on any thread.
+class ParseCache final : public Napi::ObjectWrap<ParseCache> {
+ public:
+  struct Key {
+    uint64_t hash;
+    size_t length;
+    const TSLanguage *language;
+    TSInputEncoding encoding;
+
+    bool operator==(const Key &other) const {
+      return hash == other.hash && length == other.length && language == other.language &&
+        encoding == other.encoding;
+    }
+  };
+
+  static void Init(Napi::Env env, Napi::Object exports);
+  static ParseCache *UnwrapCache(const Napi::Value &value);
+  static Key KeyFor(const TSParser *parser, const TextInput &input);
+
+  explicit ParseCache(const Napi::CallbackInfo &info);
+  ~ParseCache() final;
+
+  // Returns a copy of the tree cached for the parser's current ranges and
+  // the input's text, or null on a miss.
+  TSTree *Get(const Key &key, const TSParser *parser, const TextInput &input);
+  void Put(const Key &key, const TSParser *parser, const TextInput &input, const TSTree *tree);
+
+ private:
+  struct KeyHash {
+    size_t operator()(const Key &key) const { return static_cast<size_t>(key.hash); }
+  };
+
+  struct Entry {
+    Key key;
+    std::string text;
+    std::vector<TSRange> ranges;
+    TSTree *tree;
+    size_t bytes;
+
+    bool Matches(const TSParser *parser, const TextInput &input) const;
+  };
+
+  void Evict(size_t needed);
+
+  Napi::Value GetStats(const Napi::CallbackInfo &info);
+  Napi::Value Clear(const Napi::CallbackInfo &info);
+
+  std::mutex mutex_;
+  // Most recently used first.
+  std::list<Entry> entries_;
+  std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index_;
+  size_t max_bytes_;
+  size_t bytes_ = 0;
+  uint64_t hits_ = 0;
+  uint64_t misses_ = 0;
+  uint64_t evictions_ = 0;
+};
+
+} // namespace node_tree_sitter
+
+#endif // NODE_TREE_SITTER_PARSE_CACHE_H_
@@ -0,0 +1,118 @@
+#include "./parse_pool.h"
+
+#include <algorithm>
+
+namespace node_tree_sitter {
+
+ParsePool::ParsePool(unsigned thread_count) : caller_parser_(ts_parser_new()) {
+  threads_.reserve(thread_count);
+  for (unsigned i = 0; i < thread_count; i++) {
+    threads_.emplace_back([this] { Work(); });
+  }
+}
+
+ParsePool::~ParsePool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  for (std::thread &thread : threads_) {
+    thread.join();
+  }
+  ts_parser_delete(caller_parser_);
+}
+
+void ParsePool::Run(size_t count, const Task &task) {
+  if (count == 0) {
+    return;
+  }
+
+  auto batch = std::make_shared<Batch>();
+  batch->task = [&task](TSParser *parser, size_t index) { task(parser, index); };
+  batch->count = count;
+  batch->concurrency = count;
+
+  // The caller is blocked until the batch finishes, so it goes ahead of any
+  // submitted batches.
+  std::unique_lock<std::mutex> lock(mutex_);
+  batches_.push_front(batch);
+  wake_.notify_all();
+
+  while (batch->next < batch->count) {
+    RunTask(caller_parser_, batch, lock);
+  }
+  done_.wait(lock, [&batch] { return batch->finished == batch->count; });
+}
+
+void ParsePool::Submit(size_t count, size_t concurrency, Task task, std::function<void()> done) {
+  if (count == 0) {
+    done();
+    return;
+  }
+
+  auto batch = std::make_shared<Batch>();
+  batch->task = std::move(task);
+  batch->done = std::move(done);
+  batch->count = count;
+  batch->concurrency = std::max<size_t>(concurrency, 1);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  batches_.push_back(std::move(batch));
+  wake_.notify_all();
+}
+
+// The first batch with a task that can start now.
+std::shared_ptr<ParsePool::Batch> ParsePool::NextBatch() const {
+  for (const auto &batch : batches_) {
+    if (batch->running < batch->concurrency) {
+      return batch;
+    }
+  }
+  return nullptr;
+}
+
+// Run the next task of a batch. The lock is held before and after, but not
+// while the task runs.
+void ParsePool::RunTask(TSParser *parser, const std::shared_ptr<Batch> &batch, std::unique_lock<std::mutex> &lock) {
+  size_t index = batch->next++;
+  batch->running++;
+  if (batch->next == batch->count) {
+    batches_.erase(std::find(batches_.begin(), batches_.end(), batch));
+  }
+
+  lock.unlock();
+  batch->task(parser, index);
+  lock.lock();
+
+  batch->running--;
+  if (++batch->finished < batch->count) {
+    return;
+  }
+  if (batch->done) {
+    std::function<void()> done = std::move(batch->done);
+    batch->done = nullptr;
+    lock.unlock();
+    done();
+    lock.lock();
+  } else {
+    done_.notify_all();
+  }
+}
+
+void ParsePool::Work() {
+  TSParser *parser = ts_parser_new();
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    std::shared_ptr<Batch> batch;
+    wake_.wait(lock, [this, &batch] { return stopping_ || (batch = NextBatch()) != nullptr; });
+    if (stopping_) {
+      break;
+    }
+    RunTask(parser, batch, lock);
+  }
+  lock.unlock();
+  ts_parser_delete(parser);
+}
+
+} // namespace node_tree_sitter
@@ -0,0 +1,71 @@
+#ifndef NODE_TREE_SITTER_PARSE_POOL_H_
+#define NODE_TREE_SITTER_PARSE_POOL_H_
+
+#include "tree_sitter/api.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace node_tree_sitter {
+
+// A fixed set of native threads, each with its own parser, that stays alive
+// between batches of parses. Batches are queued, and the pool works through
+// them in order.
+//
+// A batch passed to Run is synchronous: the calling thread works through it
+// alongside the pool, and Run returns once every task in it has finished. A
+// batch passed to Submit runs only on the pool's threads, and the thread that
+// finishes its last task calls its `done` callback.
+class ParsePool final {
+ public:
+  using Task = std::function<void(TSParser *parser, size_t index)>;
+
+  explicit ParsePool(unsigned thread_count);
+  ~ParsePool();
+
+  ParsePool(const ParsePool &) = delete;
+  ParsePool &operator=(const ParsePool &) = delete;
+
+  // Call `task` once for every index in [0, count).
+  void Run(size_t count, const Task &task);
+
+  // Queue calls to `task` for every index in [0, count), with at most
+  // `concurrency` of them running at once, and return immediately. Batches
+  // that haven't finished when the pool is destroyed are dropped without
+  // calling `done`.
+  void Submit(size_t count, size_t concurrency, Task task, std::function<void()> done);
+
+ private:
+  struct Batch {
+    Task task;
+    std::function<void()> done;
+    size_t count;
+    size_t concurrency;
+    size_t next = 0;
+    size_t running = 0;
+    size_t finished = 0;
+  };
+
+  void Work();
+  std::shared_ptr<Batch> NextBatch() const;
+  void RunTask(TSParser *parser, const std::shared_ptr<Batch> &batch, std::unique_lock<std::mutex> &lock);
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  // Batches with tasks that haven't started yet.
+  std::deque<std::shared_ptr<Batch>> batches_;
+  bool stopping_ = false;
+  TSParser *caller_parser_;
+  std::vector<std::thread> threads_;
+};
+
+} // namespace node_tree_sitter
+
+#endif // NODE_TREE_SITTER_PARSE_POOL_H_
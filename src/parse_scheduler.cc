@@ -0,0 +1,408 @@
+#include "./parse_scheduler.h"
+#include "./language.h"
+#include "./text_input.h"
+#include "./tree.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <napi.h>
+#include <string>
+#include <unordered_map>
+#include <uv.h>
+
+using namespace Napi;
+
+namespace node_tree_sitter {
+
+namespace {
+
+enum Priority : uint8_t {
+  kInteractive = 0,
+  kBackground = 1,
+  kPriorityCount = 2,
+};
+
+const char *priority_names[kPriorityCount] = {
+  "interactive",
+  "background",
+};
+
+// Time spent waiting in the queue, bucketed by powers of two microseconds so
+// that percentiles can be reported without keeping every sample.
+struct WaitStats {
+  static constexpr size_t kBucketCount = 40;
+
+  uint64_t count = 0;
+  uint64_t total_micros = 0;
+  uint64_t max_micros = 0;
+  uint64_t buckets[kBucketCount] = {};
+
+  void Record(uint64_t micros) {
+    size_t bucket = 0;
+    while (bucket + 1 < kBucketCount && (uint64_t{1} << bucket) <= micros) {
+      bucket++;
+    }
+    buckets[bucket]++;
+    count++;
+    total_micros += micros;
+    max_micros = std::max(max_micros, micros);
+  }
+
+  // An upper bound for the given percentile of the recorded wait times.
+  uint64_t Percentile(double percentile) const {
+    auto goal = static_cast<uint64_t>(static_cast<double>(count) * percentile);
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < kBucketCount; bucket++) {
+      seen += buckets[bucket];
+      if (seen > goal) {
+        return std::min(max_micros, uint64_t{1} << bucket);
+      }
+    }
+    return max_micros;
+  }
+};
+
+} // namespace
+
+struct ParseScheduler::Job {
+  ~Job() {
+    ts_tree_delete(old_tree);
+    ts_tree_delete(result);
+  }
+
+  std::shared_ptr<State> state;
+  std::string key;
+  Priority priority = kInteractive;
+  const TSLanguage *language = nullptr;
+  Napi::Reference<Napi::Value> language_ref;
+  std::unique_ptr<TextInput> input;
+  TSTree *old_tree = nullptr;
+  TSTree *result = nullptr;
+  uint64_t enqueued_at = 0;
+  std::atomic<bool> cancelled {false};
+
+  // The promises waiting for this job, including those of the jobs it has
+  // superseded. Only touched on the main thread.
+  std::vector<Promise::Deferred> deferreds;
+};
+
+struct ParseScheduler::State {
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::atomic<bool> stopping {false};
+
+  // Guarded by `mutex`.
+  std::deque<std::shared_ptr<Job>> queues[kPriorityCount];
+  std::unordered_map<std::string, std::shared_ptr<Job>> latest_by_key;
+  size_t running = 0;
+  uint64_t completed = 0;
+  uint64_t coalesced = 0;
+  WaitStats waits[kPriorityCount];
+
+  // Only touched on the main thread.
+  ThreadSafeFunction complete;
+  ParseScheduler *owner = nullptr;
+  size_t outstanding = 0;
+};
+
+namespace {
+
+using Job = ParseScheduler::Job;
+using State = ParseScheduler::State;
+
+// While any job is outstanding, the scheduler's object and the thread-safe
+// function must stay alive, so that results can be delivered.
+void retain(Napi::Env env, State &state) {
+  if (state.outstanding++ == 0) {
+    state.complete.Ref(env);
+    state.owner->Ref();
+  }
+}
+
+void release(Napi::Env env, State &state) {
+  if (--state.outstanding == 0) {
+    state.complete.Unref(env);
+    state.owner->Unref();
+  }
+}
+
+void complete_job(Napi::Env env, Napi::Function /*callback*/, std::shared_ptr<Job> *data) {
+  std::shared_ptr<Job> job = std::move(*data);
+  delete data;
+
+  // The environment is being torn down, so nobody is waiting for the result.
+  if (env == nullptr) {
+    job->language_ref.SuppressDestruct();
+    return;
+  }
+
+  if (!job->deferreds.empty()) {
+    Napi::Value tree = Tree::NewInstance(env, job->result, job->input->Encoding());
+    job->result = nullptr;
+    for (Promise::Deferred &deferred : job->deferreds) {
+      deferred.Resolve(tree);
+    }
+    job->deferreds.clear();
+  }
+  job->language_ref.Reset();
+  release(env, *job->state);
+}
+
+bool is_job_cancelled(TSParseState *parse_state) {
+  auto *job = static_cast<Job *>(parse_state->payload);
+  return job->cancelled || job->state->stopping;
+}
+
+void run_worker(const std::shared_ptr<State> &state) {
+  TSParser *parser = ts_parser_new();
+
+  for (;;) {
+    std::shared_ptr<Job> job;
+    {
+      std::unique_lock<std::mutex> lock(state->mutex);
+      state->wake.wait(lock, [&] {
+        return state->stopping || !state->queues[kInteractive].empty() || !state->queues[kBackground].empty();
+      });
+      if (state->stopping) {
+        break;
+      }
+      auto &queue = state->queues[kInteractive].empty() ? state->queues[kBackground] : state->queues[kInteractive];
+      job = std::move(queue.front());
+      queue.pop_front();
+      state->waits[job->priority].Record((uv_hrtime() - job->enqueued_at) / 1000);
+      state->running++;
+    }
+
+    if (!job->cancelled) {
+      TSParseOptions options;
+      options.payload = static_cast<void *>(job.get());
+      options.progress_callback = is_job_cancelled;
+      ts_parser_set_language(parser, job->language);
+      job->result = ts_parser_parse_with_options(parser, job->old_tree, job->input->Input(), options);
+      if (job->result == nullptr) {
+        ts_parser_reset(parser);
+      }
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      state->running--;
+      state->completed++;
+      auto entry = state->latest_by_key.find(job->key);
+      if (entry != state->latest_by_key.end() && entry->second == job) {
+        state->latest_by_key.erase(entry);
+      }
+    }
+
+    auto *data = new std::shared_ptr<Job>(std::move(job));
+    if (state->complete.BlockingCall(data, complete_job) != napi_ok) {
+      delete data;
+    }
+  }
+
+  ts_parser_delete(parser);
+}
+
+Napi::Value noop(const Napi::CallbackInfo &info) {
+  return info.Env().Undefined();
+}
+
+Napi::Object wait_stats_to_js(Napi::Env env, const WaitStats &stats) {
+  Object result = Object::New(env);
+  result["count"] = Number::New(env, static_cast<double>(stats.count));
+  result["mean"] = Number::New(env, stats.count > 0 ? static_cast<double>(stats.total_micros) / stats.count : 0);
+  result["max"] = Number::New(env, static_cast<double>(stats.max_micros));
+  result["p50"] = Number::New(env, static_cast<double>(stats.Percentile(0.5)));
+  result["p99"] = Number::New(env, static_cast<double>(stats.Percentile(0.99)));
+  return result;
+}
+
+} // namespace
+
+void ParseScheduler::Init(Napi::Env env, Napi::Object exports) {
+  Function ctor = DefineClass(env, "ParseScheduler", {
+    InstanceMethod("_parse", &ParseScheduler::Parse, napi_default_method),
+    InstanceMethod("getMetrics", &ParseScheduler::GetMetrics, napi_default_method),
+    InstanceMethod("close", &ParseScheduler::Close, napi_default_method),
+  });
+
+  exports["ParseScheduler"] = ctor;
+}
+
+ParseScheduler::ParseScheduler(const Napi::CallbackInfo &info)
+  : Napi::ObjectWrap<ParseScheduler>(info), state_(std::make_shared<State>()) {
+  Napi::Env env = info.Env();
+
+  unsigned thread_count = std::thread::hardware_concurrency();
+  if (info[0].IsNumber()) {
+    thread_count = info[0].As<Number>().Uint32Value();
+  }
+  thread_count = std::max(1U, thread_count);
+
+  state_->owner = this;
+  state_->complete = ThreadSafeFunction::New(env, Function::New(env, noop), "tree-sitter.ParseScheduler", 0, 1);
+  state_->complete.Unref(env);
+
+  threads_.reserve(thread_count);
+  for (unsigned i = 0; i < thread_count; i++) {
+    threads_.emplace_back(run_worker, state_);
+  }
+}
+
+ParseScheduler::~ParseScheduler() {
+  Shutdown();
+}
+
+void ParseScheduler::Shutdown() {
+  if (state_->stopping.exchange(true)) {
+    return;
+  }
+  state_->wake.notify_all();
+  for (std::thread &thread : threads_) {
+    thread.join();
+  }
+  threads_.clear();
+  state_->complete.Release();
+}
+
+Napi::Value ParseScheduler::Parse(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  if (state_->stopping) {
+    throw Error::New(env, "ParseScheduler is closed");
+  }
+
+  const TSLanguage *language = language_methods::UnwrapLanguage(info[0]);
+  if (language == nullptr) {
+    throw TypeError::New(env, "First argument must be a language");
+  }
+  if (!info[1].IsString() && !IsByteArray(info[1])) {
+    throw TypeError::New(env, "Input must be a string or a Buffer");
+  }
+
+  auto job = std::make_shared<Job>();
+  job->state = state_;
+  job->language = language;
+  job->language_ref = Napi::Persistent(info[0]);
+
+  if (info[2].IsString()) {
+    job->key = info[2].As<String>();
+  } else if (!info[2].IsUndefined() && !info[2].IsNull()) {
+    throw TypeError::New(env, "Key must be a string");
+  }
+
+  if (info[3].IsString() && info[3].As<String>().Utf8Value() == priority_names[kBackground]) {
+    job->priority = kBackground;
+  } else if (!info[3].IsUndefined() && !(info[3].IsString() && info[3].As<String>().Utf8Value() == priority_names[kInteractive])) {
+    throw TypeError::New(env, "Priority must be 'interactive' or 'background'");
+  }
+
+  const Tree *js_old_tree = nullptr;
+  if (!info[4].IsUndefined() && !info[4].IsNull()) {
+    js_old_tree = Tree::UnwrapTree(info[4]);
+    if (js_old_tree == nullptr) {
+      throw TypeError::New(env, "Old tree must be a tree");
+    }
+  }
+
+  job->input = TextInputFromJS(info[1], info[5], js_old_tree, false);
+  if (!job->input) {
+    return env.Undefined();
+  }
+  if (js_old_tree != nullptr && js_old_tree->encoding_ == job->input->Encoding()) {
+    job->old_tree = ts_tree_copy(js_old_tree->tree_);
+  }
+
+  Promise::Deferred deferred = Promise::Deferred::New(env);
+  job->deferreds.push_back(deferred);
+  job->enqueued_at = uv_hrtime();
+  retain(env, *state_);
+
+  std::shared_ptr<Job> dropped;
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    if (!job->key.empty()) {
+      auto entry = state_->latest_by_key.find(job->key);
+      if (entry != state_->latest_by_key.end()) {
+        std::shared_ptr<Job> previous = entry->second;
+        job->deferreds.insert(job->deferreds.end(), previous->deferreds.begin(), previous->deferreds.end());
+        previous->deferreds.clear();
+        job->priority = std::min(job->priority, previous->priority);
+        state_->coalesced++;
+
+        auto &queue = state_->queues[previous->priority];
+        auto queued = std::find(queue.begin(), queue.end(), previous);
+        if (queued != queue.end()) {
+          queue.erase(queued);
+          dropped = std::move(previous);
+        } else {
+          previous->cancelled = true;
+        }
+        entry->second = job;
+      } else {
+        state_->latest_by_key.emplace(job->key, job);
+      }
+    }
+    state_->queues[job->priority].push_back(job);
+  }
+  state_->wake.notify_one();
+
+  // A superseded job that never started is finished here rather than by a
+  // worker thread.
+  if (dropped) {
+    dropped->language_ref.Reset();
+    release(env, *state_);
+  }
+
+  return deferred.Promise();
+}
+
+Napi::Value ParseScheduler::GetMetrics(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+  Object result = Object::New(env);
+
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  result["running"] = Number::New(env, static_cast<double>(state_->running));
+  result["completed"] = Number::New(env, static_cast<double>(state_->completed));
+  result["coalesced"] = Number::New(env, static_cast<double>(state_->coalesced));
+  for (uint8_t priority = 0; priority < kPriorityCount; priority++) {
+    Object queue = Object::New(env);
+    queue["queued"] = Number::New(env, static_cast<double>(state_->queues[priority].size()));
+    queue["waitMicros"] = wait_stats_to_js(env, state_->waits[priority]);
+    result[priority_names[priority]] = queue;
+  }
+  return result;
+}
+
+// Reject every job that hasn't started, halt the running ones, and stop the
+// worker threads. Halted jobs resolve to null.
+Napi::Value ParseScheduler::Close(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  std::vector<std::shared_ptr<Job>> queued;
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    for (auto &queue : state_->queues) {
+      queued.insert(queued.end(), queue.begin(), queue.end());
+      queue.clear();
+    }
+    state_->latest_by_key.clear();
+  }
+
+  Shutdown();
+
+  for (std::shared_ptr<Job> &job : queued) {
+    for (Promise::Deferred &deferred : job->deferreds) {
+      deferred.Reject(Error::New(env, "ParseScheduler was closed").Value());
+    }
+    job->deferreds.clear();
+    job->language_ref.Reset();
+    release(env, *state_);
+  }
+
+  return env.Undefined();
+}
+
+} // namespace node_tree_sitter
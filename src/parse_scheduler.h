@@ -0,0 +1,40 @@
+#ifndef NODE_TREE_SITTER_PARSE_SCHEDULER_H_
+#define NODE_TREE_SITTER_PARSE_SCHEDULER_H_
+
+#include "tree_sitter/api.h"
+
+#include <memory>
+#include <napi.h>
+#include <thread>
+#include <vector>
+
+namespace node_tree_sitter {
+
+// Runs parse jobs on a fixed pool of native threads. Interactive jobs are
+// always started before background ones, and a job for a document key that
+// already has a queued or running job supersedes it: the older job is dropped
+// (or cancelled, if it's running) and its callers get the newer job's tree.
+class ParseScheduler final : public Napi::ObjectWrap<ParseScheduler> {
+ public:
+  static void Init(Napi::Env env, Napi::Object exports);
+
+  explicit ParseScheduler(const Napi::CallbackInfo &);
+  ~ParseScheduler() final;
+
+  struct Job;
+  struct State;
+
+ private:
+  std::shared_ptr<State> state_;
+  std::vector<std::thread> threads_;
+
+  void Shutdown();
+
+  Napi::Value Parse(const Napi::CallbackInfo &);
+  Napi::Value GetMetrics(const Napi::CallbackInfo &);
+  Napi::Value Close(const Napi::CallbackInfo &);
+};
+
+} // namespace node_tree_sitter
+
+#endif // NODE_TREE_SITTER_PARSE_SCHEDULER_H_
@@ -0,0 +1,126 @@
+#include "./parse_stats.h"
+
+#include <mutex>
+#include <napi.h>
+
+using namespace Napi;
+
+namespace node_tree_sitter {
+
+namespace {
+
+std::mutex process_stats_mutex;
+ParseStats process_stats;
+
+Napi::Value ratio_to_js(Napi::Env env, uint64_t part, uint64_t whole) {
+  if (whole == 0) {
+    return env.Null();
+  }
+  return Number::New(env, static_cast<double>(part) / static_cast<double>(whole));
+}
+
+uint64_t count_errors(TSNode root) {
+  if (!ts_node_has_error(root)) {
+    return 0;
+  }
+
+  uint64_t count = 0;
+  TSTreeCursor cursor = ts_tree_cursor_new(root);
+  while (true) {
+    TSNode node = ts_tree_cursor_current_node(&cursor);
+    if (ts_node_is_error(node) || ts_node_is_missing(node)) {
+      count++;
+    }
+    if (ts_node_has_error(node) && ts_tree_cursor_goto_first_child(&cursor)) {
+      continue;
+    }
+    while (!ts_tree_cursor_goto_next_sibling(&cursor)) {
+      if (!ts_tree_cursor_goto_parent(&cursor)) {
+        ts_tree_cursor_delete(&cursor);
+        return count;
+      }
+    }
+  }
+}
+
+} // namespace
+
+const char *MeasuredInput::Read(void *payload, uint32_t byte, TSPoint position, uint32_t *bytes_read) {
+  auto *self = static_cast<MeasuredInput *>(payload);
+  const char *result = self->input_.read(self->input_.payload, byte, position, bytes_read);
+  self->sample_->read_count++;
+  self->sample_->bytes_read += *bytes_read;
+  return result;
+}
+
+void MeasureTree(const TSTree *old_tree, const TSTree *tree, ParseSample *sample) {
+  TSNode root = ts_tree_root_node(tree);
+  sample->error_count = count_errors(root);
+  sample->incremental = old_tree != nullptr;
+  if (old_tree == nullptr) {
+    return;
+  }
+
+  uint32_t range_count;
+  TSRange *ranges = ts_tree_get_changed_ranges(old_tree, tree, &range_count);
+  uint64_t changed_bytes = 0;
+  for (uint32_t i = 0; i < range_count; i++) {
+    changed_bytes += ranges[i].end_byte - ranges[i].start_byte;
+  }
+  free(ranges);
+
+  sample->tree_bytes = ts_node_end_byte(root);
+  sample->reused_bytes = sample->tree_bytes > changed_bytes ? sample->tree_bytes - changed_bytes : 0;
+}
+
+void ParseStats::Add(const ParseSample &sample) {
+  parse_count_++;
+  nanos_ += sample.nanos;
+  read_count_ += sample.read_count;
+  bytes_read_ += sample.bytes_read;
+  error_count_ += sample.error_count;
+  cache_hits_ += sample.cache_hit ? 1 : 0;
+  if (sample.incremental) {
+    incremental_count_++;
+    tree_bytes_ += sample.tree_bytes;
+    reused_bytes_ += sample.reused_bytes;
+  }
+  last_ = sample;
+}
+
+Napi::Object ParseStats::ToJS(Napi::Env env) const {
+  Object result = Object::New(env);
+  result["parseCount"] = Number::New(env, static_cast<double>(parse_count_));
+  result["parseTimeMicros"] = Number::New(env, static_cast<double>(nanos_) / 1000);
+  result["readCount"] = Number::New(env, static_cast<double>(read_count_));
+  result["bytesRead"] = Number::New(env, static_cast<double>(bytes_read_));
+  result["errorCount"] = Number::New(env, static_cast<double>(error_count_));
+  result["cacheHits"] = Number::New(env, static_cast<double>(cache_hits_));
+  result["incrementalParseCount"] = Number::New(env, static_cast<double>(incremental_count_));
+  result["reusedBytes"] = Number::New(env, static_cast<double>(reused_bytes_));
+  result["reuseRatio"] = ratio_to_js(env, reused_bytes_, tree_bytes_);
+  return result;
+}
+
+void RecordProcessSample(const ParseSample &sample) {
+  std::lock_guard<std::mutex> lock(process_stats_mutex);
+  process_stats.Add(sample);
+}
+
+Napi::Object ProcessStatsToJS(Napi::Env env) {
+  std::lock_guard<std::mutex> lock(process_stats_mutex);
+  return process_stats.ToJS(env);
+}
+
+Napi::Object ParseSampleToJS(Napi::Env env, const ParseSample &sample) {
+  Object result = Object::New(env);
+  result["parseTimeMicros"] = Number::New(env, static_cast<double>(sample.nanos) / 1000);
+  result["readCount"] = Number::New(env, static_cast<double>(sample.read_count));
+  result["bytesRead"] = Number::New(env, static_cast<double>(sample.bytes_read));
+  result["errorCount"] = Number::New(env, static_cast<double>(sample.error_count));
+  result["cacheHit"] = Boolean::New(env, sample.cache_hit);
+  result["reuseRatio"] = sample.incremental ? ratio_to_js(env, sample.reused_bytes, sample.tree_bytes) : env.Null();
+  return result;
+}
+
+} // namespace node_tree_sitter
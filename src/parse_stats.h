@@ -0,0 +1,83 @@
+#ifndef NODE_TREE_SITTER_PARSE_STATS_H_
+#define NODE_TREE_SITTER_PARSE_STATS_H_
+
+#include "tree_sitter/api.h"
+
+#include <cstdint>
+#include <napi.h>
+
+namespace node_tree_sitter {
+
+// What it cost to produce one tree. A time-sliced parse accumulates into the
+// same sample until it finishes.
+struct ParseSample {
+  uint64_t nanos = 0;
+  uint64_t read_count = 0;
+  uint64_t bytes_read = 0;
+  uint64_t error_count = 0;
+  bool cache_hit = false;
+
+  // Only set when the tree was parsed incrementally: its length, and how many
+  // of its bytes lie outside the ranges that changed from the old tree.
+  bool incremental = false;
+  uint64_t tree_bytes = 0;
+  uint64_t reused_bytes = 0;
+};
+
+// Wraps an input so that every read is counted into a sample.
+class MeasuredInput final {
+ public:
+  MeasuredInput(TSInput input, ParseSample *sample) : input_(input), sample_(sample) {}
+
+  TSInput Input() {
+    TSInput result = input_;
+    result.payload = static_cast<void *>(this);
+    result.read = Read;
+    return result;
+  }
+
+ private:
+  static const char *Read(void *payload, uint32_t byte, TSPoint position, uint32_t *bytes_read);
+
+  TSInput input_;
+  ParseSample *sample_;
+};
+
+// Fill in the parts of a sample that depend on the resulting tree. Errors are
+// counted by only descending into subtrees that contain one, and reuse comes
+// from the changed ranges, so neither walks the whole tree.
+void MeasureTree(const TSTree *old_tree, const TSTree *tree, ParseSample *sample);
+
+// Running totals of parse samples. Not thread safe; see RecordProcessSample
+// for totals that are shared between threads.
+class ParseStats final {
+ public:
+  void Add(const ParseSample &sample);
+  Napi::Object ToJS(Napi::Env env) const;
+
+  uint64_t ParseCount() const { return parse_count_; }
+  const ParseSample &Last() const { return last_; }
+
+ private:
+  uint64_t parse_count_ = 0;
+  uint64_t nanos_ = 0;
+  uint64_t read_count_ = 0;
+  uint64_t bytes_read_ = 0;
+  uint64_t error_count_ = 0;
+  uint64_t cache_hits_ = 0;
+  uint64_t incremental_count_ = 0;
+  uint64_t tree_bytes_ = 0;
+  uint64_t reused_bytes_ = 0;
+  ParseSample last_;
+};
+
+// Add a sample to the totals for the whole process, from any thread.
+void RecordProcessSample(const ParseSample &sample);
+
+Napi::Object ProcessStatsToJS(Napi::Env env);
+
+Napi::Object ParseSampleToJS(Napi::Env env, const ParseSample &sample);
+
+} // namespace node_tree_sitter
+
+#endif // NODE_TREE_SITTER_PARSE_STATS_H_
@@ -1,11 +1,22 @@
 #include "./parser.h"
+#include "./cancellation.h"
 #include "./conversions.h"
 #include "./language.h"
 #include "./logger.h"
+#include "./parse_cache.h"
+#include "./parse_stats.h"
+#include "./source_file.h"
+#include "./text_input.h"
 #include "./tree.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstddef>
+#include <memory>
 #include <napi.h>
+#include <string>
+#include <thread>
 #include <vector>
 
 using namespace Napi;
@@ -60,8 +71,8 @@ class CallbackInput final {
     } else {
       Function callback = reader->callback.Value();
       Napi::Value result_value = callback({
-        ByteCountToJS(env, byte),
-        PointToJS(env, position),
+        ByteCountToJS(env, byte, TSInputEncodingUTF16LE),
+        PointToJS(env, position, TSInputEncodingUTF16LE),
       });
       if (env.IsExceptionPending()) {
         return nullptr;
@@ -109,35 +120,300 @@ class CallbackInput final {
   ObjectReference partial_string;
 };
 
-class CallbackProgress final {
+// Decides on each progress tick whether to halt a parse. The cancellation
+// flag and deadline are checked natively, and the JS callback, if there is
+// one, is only called when neither has fired.
+class ParseProgress final {
  public:
-  static TSParseOptions Make(const Napi::Function &func) {
+  ParseProgress(Cancellation cancellation, const Napi::Value &callback) : cancellation(std::move(cancellation)) {
+    if (callback.IsFunction()) {
+      func = Napi::Persistent(callback.As<Function>());
+    }
+  }
+
+  bool IsEnabled() const { return cancellation.IsEnabled() || !func.IsEmpty(); }
+
+  TSParseOptions Options() {
     TSParseOptions options;
-    auto *callback = new CallbackProgress();
-    callback->func = Napi::Persistent(func);
-    options.payload = static_cast<void *>(callback);
+    options.payload = static_cast<void *>(this);
     options.progress_callback = Cancel;
     return options;
   }
 
   private:
+  Cancellation cancellation;
   Napi::FunctionReference func;
 
   static bool Cancel(TSParseState *state) {
-    auto *callback = static_cast<CallbackProgress *>(state->payload);
-    Env env = callback->func.Env();
+    auto *progress = static_cast<ParseProgress *>(state->payload);
+    if (progress->cancellation.IsCancelled()) {
+      return true;
+    }
+    if (progress->func.IsEmpty()) {
+      return false;
+    }
+    Env env = progress->func.Env();
     Number index = Number::New(env, state->current_byte_offset);
     Boolean has_error = Boolean::New(env, state->has_error);
-    return callback->func({ index, has_error }).As<Boolean>();
+    return progress->func({ index, has_error }).As<Boolean>();
   }
 };
 
+// Parse any input, counting its reads and the time spent into the sample.
+TSTree *parse_input(TSParser *parser, const TSTree *old_tree, TSInput input, ParseProgress *progress, ParseSample *sample) {
+  MeasuredInput measured_input(input, sample);
+  auto start = std::chrono::steady_clock::now();
+  TSTree *tree;
+  if (progress != nullptr && progress->IsEnabled()) {
+    tree = ts_parser_parse_with_options(parser, old_tree, measured_input.Input(), progress->Options());
+  } else {
+    tree = ts_parser_parse(parser, old_tree, measured_input.Input());
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  sample->nanos += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+  if (tree != nullptr) {
+    MeasureTree(old_tree, tree, sample);
+  }
+  return tree;
+}
+
+// Parse text from native memory, or copy the cached tree for the same text if
+// the parser has a cache. Incremental parses bypass the cache, so that the new
+// tree always shares structure with the old one.
+TSTree *parse_text(TSParser *parser, ParseCache *cache, const TSTree *old_tree, TextInput &input, ParseProgress &progress, ParseSample *sample) {
+  bool use_cache = cache != nullptr && old_tree == nullptr;
+  ParseCache::Key key {};
+  if (use_cache) {
+    key = ParseCache::KeyFor(parser, input);
+    if (TSTree *tree = cache->Get(key, parser, input)) {
+      sample->cache_hit = true;
+      MeasureTree(nullptr, tree, sample);
+      return tree;
+    }
+  }
+
+  TSTree *tree = parse_input(parser, old_tree, input.Input(), &progress, sample);
+  if (use_cache && tree != nullptr) {
+    cache->Put(key, parser, input, tree);
+  }
+  return tree;
+}
+
+class ParseWorker final : public AsyncWorker {
+ public:
+  // Parse text that has been copied into native memory. If `retain` is set,
+  // the resulting tree keeps the copy.
+  ParseWorker(
+    Napi::Env env,
+    Parser *parser,
+    const TSTree *old_tree,
+    std::unique_ptr<TextInput> input,
+    bool retain,
+    Cancellation cancellation
+  ) : ParseWorker(env, parser, old_tree, input->Encoding(), std::move(cancellation)) {
+    input_ = std::move(input);
+    retain_ = retain;
+  }
+
+  // Parse a file, which is read on the background thread, or mapped if `map`
+  // is set. The resulting tree keeps the file's contents.
+  ParseWorker(
+    Napi::Env env,
+    Parser *parser,
+    const TSTree *old_tree,
+    std::string path,
+    TSInputEncoding encoding,
+    bool map,
+    Cancellation cancellation
+  ) : ParseWorker(env, parser, old_tree, encoding, std::move(cancellation)) {
+    path_ = std::move(path);
+    map_ = map;
+    retain_ = true;
+  }
+
+  ~ParseWorker() final {
+    ts_tree_delete(old_tree_);
+  }
+
+  Napi::Promise GetPromise() const { return deferred_.Promise(); }
+
+ protected:
+  void Execute() final {
+    if (!input_) {
+      std::string error;
+      file_ = SourceFile::Open(path_, map_, &error);
+      if (!file_) {
+        SetError(error);
+        return;
+      }
+      input_ = std::make_unique<TextInput>(file_->Data(), file_->Size(), encoding_);
+    }
+    result_ = parse_text(parser_->parser_, parser_->cache_, old_tree_, *input_, progress_, &sample_);
+  }
+
+  void OnOK() final {
+    Finish();
+    Napi::Value tree = Tree::NewInstance(Env(), result_, encoding_);
+    if (retain_ && result_ != nullptr) {
+      Tree::Unwrap(tree.As<Object>())->source_ = file_ ? file_ : SourceFile::FromString(input_->TakeText());
+    }
+    deferred_.Resolve(tree);
+  }
+
+  void OnError(const Error &error) final {
+    Finish();
+    deferred_.Reject(error.Value());
+  }
+
+ private:
+  ParseWorker(Napi::Env env, Parser *parser, const TSTree *old_tree, TSInputEncoding encoding, Cancellation cancellation)
+    : AsyncWorker(env, "tree-sitter.parseAsync"),
+      deferred_(Promise::Deferred::New(env)),
+      parser_(parser),
+      old_tree_(old_tree != nullptr ? ts_tree_copy(old_tree) : nullptr),
+      encoding_(encoding),
+      progress_(std::move(cancellation), env.Undefined()),
+      logger_(ts_parser_logger(parser->parser_)) {
+    // The parser's object and logger must outlive the background parse. A
+    // JS logger is detached while the parse is running, since it can't be
+    // called from the background thread. A log buffer can stay attached.
+    parser_ref_ = Napi::Persistent(parser->Value());
+    if (logger_.log == Logger::Log) {
+      ts_parser_set_logger(parser_->parser_, { nullptr, nullptr });
+    }
+    parser_->is_parsing_async_ = true;
+  }
+
+  // The sample is recorded here, on the main thread, so that the parser's
+  // stats can be read at any time without a lock.
+  void Finish() {
+    if (input_) {
+      parser_->RecordSample(sample_);
+    }
+    ts_parser_set_logger(parser_->parser_, logger_);
+    parser_->is_parsing_async_ = false;
+    parser_ref_.Reset();
+  }
+
+  Promise::Deferred deferred_;
+  Parser *parser_;
+  ObjectReference parser_ref_;
+  TSTree *old_tree_;
+  TSInputEncoding encoding_;
+  ParseProgress progress_;
+  std::unique_ptr<TextInput> input_;
+  std::string path_;
+  std::shared_ptr<SourceFile> file_;
+  bool map_ = false;
+  bool retain_ = false;
+  TSLogger logger_;
+  TSTree *result_ = nullptr;
+  ParseSample sample_;
+};
+
+// Parses a batch of inputs on a fixed number of native threads, each with its
+// own TSParser. Inputs are handed out one at a time, so a few large files
+// don't hold up the rest of the batch.
+// A batch of parses that runs on the shared parse pool. No libuv thread waits
+// for it: the pool thread that finishes the last parse hands the job back to
+// the main thread through a thread-safe function, which settles the promise.
+class ParseManyJob final {
+ public:
+  static Napi::Promise Start(Napi::Env env, const Napi::Value &language, std::vector<TextInput> inputs, unsigned concurrency) {
+    auto job = std::make_shared<ParseManyJob>(env, language, std::move(inputs));
+    Napi::Promise promise = job->deferred_.Promise();
+    ParseManyJob *raw = job.get();
+    env.GetInstanceData<AddonData>()->GetParsePool().Submit(
+      raw->inputs_.size(),
+      concurrency,
+      [raw](TSParser *parser, size_t i) { raw->Parse(parser, i); },
+      [job]() mutable {
+        // The job must be destroyed on the main thread, since it holds
+        // references to JS values.
+        auto *data = new std::shared_ptr<ParseManyJob>(std::move(job));
+        ThreadSafeFunction complete = (*data)->complete_;
+        if (complete.BlockingCall(data, Settle) != napi_ok) {
+          (*data)->language_ref_.SuppressDestruct();
+          delete data;
+        }
+      }
+    );
+    return promise;
+  }
+
+  ParseManyJob(Napi::Env env, const Napi::Value &language, std::vector<TextInput> inputs)
+    : deferred_(Promise::Deferred::New(env)),
+      language_(language_methods::UnwrapLanguage(language)),
+      language_ref_(Napi::Persistent(language)),
+      inputs_(std::move(inputs)),
+      results_(inputs_.size(), nullptr),
+      complete_(ThreadSafeFunction::New(env, Function::New(env, noop), "tree-sitter.parseMany", 0, 1)) {}
+
+  ~ParseManyJob() {
+    for (TSTree *tree : results_) {
+      ts_tree_delete(tree);
+    }
+  }
+
+ private:
+  void Parse(TSParser *parser, size_t i) {
+    // The pool's parsers are shared, so each parse sets up its own state.
+    if (!ts_parser_set_language(parser, language_)) {
+      language_failed_ = true;
+      return;
+    }
+    ts_parser_set_included_ranges(parser, nullptr, 0);
+    ParseSample sample;
+    results_[i] = parse_input(parser, nullptr, inputs_[i].Input(), nullptr, &sample);
+    RecordProcessSample(sample);
+  }
+
+  static void Settle(Napi::Env env, Function /*callback*/, std::shared_ptr<ParseManyJob> *data) {
+    std::shared_ptr<ParseManyJob> job = std::move(*data);
+    delete data;
+    job->complete_.Release();
+
+    // The environment is being torn down, so nobody is waiting for the result.
+    if (env == nullptr) {
+      job->language_ref_.SuppressDestruct();
+      return;
+    }
+
+    if (job->language_failed_) {
+      job->deferred_.Reject(Error::New(env, "Incompatible language version").Value());
+      return;
+    }
+    Array result = Array::New(env, job->results_.size());
+    for (uint32_t i = 0; i < job->results_.size(); i++) {
+      result[i] = Tree::NewInstance(env, job->results_[i], job->inputs_[i].Encoding());
+      job->results_[i] = nullptr;
+    }
+    job->deferred_.Resolve(result);
+  }
+
+  static Napi::Value noop(const Napi::CallbackInfo &info) {
+    return info.Env().Undefined();
+  }
+
+  Promise::Deferred deferred_;
+  const TSLanguage *language_;
+  Napi::Reference<Napi::Value> language_ref_;
+  std::vector<TextInput> inputs_;
+  std::vector<TSTree *> results_;
+  std::atomic<bool> language_failed_ {false};
+  ThreadSafeFunction complete_;
+};
+
 void Parser::Init(Napi::Env env, Napi::Object exports) {
   auto *data = env.GetInstanceData<AddonData>();
 
   Function ctor = DefineClass(env, "Parser", {
     InstanceMethod("setLanguage", &Parser::SetLanguage, napi_default_method),
     InstanceMethod("parse", &Parser::Parse, napi_default_method),
+    InstanceMethod("parseAsync", &Parser::ParseAsync, napi_default_method),
+    InstanceMethod("parseFile", &Parser::ParseFile, napi_default_method),
+    InstanceMethod("parseFileAsync", &Parser::ParseFileAsync, napi_default_method),
+    InstanceMethod("parseSlice", &Parser::ParseSlice, napi_default_method),
     InstanceMethod("getIncludedRanges", &Parser::IncludedRanges, napi_default_method),
     InstanceMethod("getTimeoutMicros", &Parser::TimeoutMicros, napi_default_method),
     InstanceMethod("setTimeoutMicros", &Parser::SetTimeoutMicros, napi_default_method),
@@ -145,6 +421,11 @@ void Parser::Init(Napi::Env env, Napi::Object exports) {
     InstanceMethod("setLogger", &Parser::SetLogger, napi_default_method),
     InstanceMethod("printDotGraphs", &Parser::PrintDotGraphs, napi_default_method),
     InstanceMethod("reset", &Parser::Reset, napi_default_method),
+    InstanceMethod("getCache", &Parser::GetCache, napi_default_method),
+    InstanceMethod("setCache", &Parser::SetCache, napi_default_method),
+    InstanceMethod("stats", &Parser::Stats, napi_default_method),
+    StaticMethod("parseMany", &Parser::ParseMany, napi_default_method),
+    StaticMethod("stats", &Parser::ProcessStats, napi_default_method),
   });
 
   data->parser_constructor = Napi::Persistent(ctor);
@@ -159,6 +440,7 @@ void Parser::Init(Napi::Env env, Napi::Object exports) {
 Parser::Parser(const Napi::CallbackInfo &info) : Napi::ObjectWrap<Parser>(info), parser_(ts_parser_new()) {}
 
 Parser::~Parser() {
+  ts_tree_delete(slice_old_tree_);
   ts_parser_print_dot_graphs(parser_, -1);
   ts_parser_set_logger(parser_, { nullptr, nullptr });
   ts_parser_delete(parser_);
@@ -166,7 +448,7 @@ Parser::~Parser() {
 
 namespace {
 
-bool handle_included_ranges(Napi::Env env, TSParser *parser, Napi::Value arg) {
+bool handle_included_ranges(Napi::Env env, TSParser *parser, Napi::Value arg, TSInputEncoding encoding) {
   uint32_t last_included_range_end = 0;
   if (arg.IsArray()) {
     auto js_included_ranges = arg.As<Array>();
@@ -176,7 +458,7 @@ bool handle_included_ranges(Napi::Env env, TSParser *parser, Napi::Value arg) {
       if (!range_value.IsObject()) {
         return false;
       }
-      auto maybe_range = RangeFromJS(range_value);
+      auto maybe_range = RangeFromJS(range_value, encoding);
       if (!maybe_range.IsJust()) {
         return false;
       }
@@ -195,9 +477,35 @@ bool handle_included_ranges(Napi::Env env, TSParser *parser, Napi::Value arg) {
   return true;
 }
 
+const TSTree *reusable_tree(const Tree *old_tree, TSInputEncoding encoding) {
+  if (old_tree == nullptr || old_tree->encoding_ != encoding) {
+    return nullptr;
+  }
+  return old_tree->tree_;
+}
+
 } // namespace
 
+void Parser::EnsureIdle(Napi::Env env) const {
+  if (is_parsing_async_) {
+    throw Error::New(env, "Parser is busy with an asynchronous parse");
+  }
+}
+
+// Any other parse would otherwise resume the halted slice with the wrong input.
+void Parser::DiscardSlice() {
+  if (slice_input_) {
+    ts_parser_reset(parser_);
+    slice_input_.reset();
+    slice_sample_ = {};
+    ts_tree_delete(slice_old_tree_);
+    slice_old_tree_ = nullptr;
+  }
+}
+
 Napi::Value Parser::SetLanguage(const Napi::CallbackInfo &info) {
+  EnsureIdle(info.Env());
+  DiscardSlice();
   const TSLanguage *language = language_methods::UnwrapLanguage(info[0]);
   if (language != nullptr) {
     ts_parser_set_language(parser_, language);
@@ -208,61 +516,316 @@ Napi::Value Parser::SetLanguage(const Napi::CallbackInfo &info) {
 
 Napi::Value Parser::Parse(const CallbackInfo &info) {
   Napi::Env env = info.Env();
+  EnsureIdle(env);
+  DiscardSlice();
 
-  if (!info[0].IsFunction()) {
-    throw TypeError::New(env, "Input must be a function");
+  if (!info[0].IsString() && !IsByteArray(info[0]) && !info[0].IsArray() && !info[0].IsFunction()) {
+    throw TypeError::New(env, "Input must be a string, a Buffer, an array of chunks or a function");
   }
 
-  auto callback = info[0].As<Function>();
-
-  Object js_old_tree;
-  const TSTree *old_tree = nullptr;
+  const Tree *js_old_tree = nullptr;
   if (info.Length() > 1 && !info[1].IsNull() && !info[1].IsUndefined() && info[1].IsObject()) {
-    js_old_tree = info[1].As<Object>();
-    const Tree *tree = Tree::UnwrapTree(js_old_tree);
-    if (tree == nullptr) {
+    js_old_tree = Tree::UnwrapTree(info[1]);
+    if (js_old_tree == nullptr) {
       throw TypeError::New(env, "Second argument must be a tree");
     }
-    old_tree = tree->tree_;
   }
 
-  CallbackInput callback_input(callback, info.Length() > 2 ? info[2] : env.Null());
+  // Strings are copied into native memory once, up front, rather than being
+  // read back through a JS callback in `bufferSize` chunks. Byte arrays can't
+  // be collected during a synchronous parse, so they aren't copied at all,
+  // unless a progress callback or a JS logger could modify or detach them
+  // while the parser is reading them.
+  bool borrow = !info[4].IsFunction() && ts_parser_logger(parser_).log != Logger::Log;
+  std::unique_ptr<TextInput> text_input;
+  std::unique_ptr<ChunkedInput> chunked_input;
+  std::unique_ptr<CallbackInput> callback_input;
+  TSInput input;
+  if (info[0].IsArray()) {
+    chunked_input = ChunkedInputFromJS(info[0].As<Array>(), info[5], borrow);
+    if (!chunked_input) {
+      return env.Undefined();
+    }
+    input = chunked_input->Input();
+  } else if (!info[0].IsFunction()) {
+    text_input = TextInputFromJS(info[0], info[5], js_old_tree, borrow);
+    if (!text_input) {
+      return env.Undefined();
+    }
+    input = text_input->Input();
+  } else {
+    callback_input = std::make_unique<CallbackInput>(info[0].As<Function>(), info.Length() > 2 ? info[2] : env.Null());
+    input = callback_input->Input();
+  }
+  encoding_ = input.encoding;
+  const TSTree *old_tree = reusable_tree(js_old_tree, encoding_);
 
   if (info.Length() > 3) {
-    if (!handle_included_ranges(env, parser_, info[3])) {
+    if (!handle_included_ranges(env, parser_, info[3], encoding_)) {
       return env.Undefined();
     }
   }
 
+  ParseProgress progress(Cancellation::FromJS(info[6], info[7]), info[4]);
+  ParseSample sample;
   TSTree *tree;
-  if (info.Length() > 4 && info[4].IsFunction()) {
-    TSParseOptions options = CallbackProgress::Make(info[4].As<Function>());
-    tree = ts_parser_parse_with_options(parser_, old_tree, callback_input.Input(), options);
+  if (text_input) {
+    tree = parse_text(parser_, cache_, old_tree, *text_input, progress, &sample);
   } else {
-    tree = ts_parser_parse(parser_, old_tree, callback_input.Input());
+    tree = parse_input(parser_, old_tree, input, &progress, &sample);
   }
-  return Tree::NewInstance(env, tree);
+  RecordSample(sample);
+
+  Napi::Value result = Tree::NewInstance(env, tree, encoding_);
+  // Text read from a callback is never all in native memory, so only the
+  // other inputs can be retained.
+  bool retain = info[8].IsBoolean() && info[8].As<Boolean>();
+  if (retain && tree != nullptr && !callback_input) {
+    Tree::Unwrap(result.As<Object>())->source_ = SourceFile::FromString(
+      text_input ? text_input->TakeText() : chunked_input->Text()
+    );
+  }
+  return result;
+}
+
+Napi::Value Parser::ParseAsync(const CallbackInfo &info) {
+  Napi::Env env = info.Env();
+  EnsureIdle(env);
+  DiscardSlice();
+
+  if (!info[0].IsString() && !IsByteArray(info[0])) {
+    throw TypeError::New(env, "Input must be a string or a Buffer");
+  }
+
+  const Tree *js_old_tree = nullptr;
+  if (info.Length() > 1 && !info[1].IsNull() && !info[1].IsUndefined()) {
+    js_old_tree = Tree::UnwrapTree(info[1]);
+    if (js_old_tree == nullptr) {
+      throw TypeError::New(env, "Second argument must be a tree");
+    }
+  }
+
+  std::unique_ptr<TextInput> text_input = TextInputFromJS(info[0], info[3], js_old_tree, false);
+  if (!text_input) {
+    return env.Undefined();
+  }
+  encoding_ = text_input->Encoding();
+
+  if (info.Length() > 2) {
+    if (!handle_included_ranges(env, parser_, info[2], encoding_)) {
+      return env.Undefined();
+    }
+  }
+
+  const TSTree *old_tree = reusable_tree(js_old_tree, encoding_);
+  Cancellation cancellation = Cancellation::FromJS(info[4], info[5]);
+  bool retain = info[6].IsBoolean() && info[6].As<Boolean>();
+  auto *worker = new ParseWorker(env, this, old_tree, std::move(text_input), retain, std::move(cancellation));
+  Napi::Promise promise = worker->GetPromise();
+  worker->Queue();
+  return promise;
+}
+
+Napi::Value Parser::ParseFile(const CallbackInfo &info) {
+  Napi::Env env = info.Env();
+  EnsureIdle(env);
+  DiscardSlice();
+
+  if (!info[0].IsString()) {
+    throw TypeError::New(env, "First argument must be a path");
+  }
+  std::string path = info[0].As<String>();
+
+  const Tree *js_old_tree = nullptr;
+  if (info.Length() > 1 && !info[1].IsNull() && !info[1].IsUndefined()) {
+    js_old_tree = Tree::UnwrapTree(info[1]);
+    if (js_old_tree == nullptr) {
+      throw TypeError::New(env, "Second argument must be a tree");
+    }
+  }
+
+  TSInputEncoding encoding = EncodingFromJS(info[2], TSInputEncodingUTF8);
+  bool map = info[3].IsBoolean() && info[3].As<Boolean>();
+
+  std::string error;
+  std::shared_ptr<SourceFile> file = SourceFile::Open(path, map, &error);
+  if (!file) {
+    throw Error::New(env, error);
+  }
+
+  encoding_ = encoding;
+  TextInput input(file->Data(), file->Size(), encoding);
+  const TSTree *old_tree = reusable_tree(js_old_tree, encoding);
+  ParseProgress progress(Cancellation::FromJS(info[4], info[5]), env.Undefined());
+  ParseSample sample;
+  TSTree *tree = parse_text(parser_, cache_, old_tree, input, progress, &sample);
+  RecordSample(sample);
+  Napi::Value result = Tree::NewInstance(env, tree, encoding);
+  if (tree != nullptr) {
+    Tree::Unwrap(result.As<Object>())->source_ = std::move(file);
+  }
+  return result;
+}
+
+Napi::Value Parser::ParseFileAsync(const CallbackInfo &info) {
+  Napi::Env env = info.Env();
+  EnsureIdle(env);
+  DiscardSlice();
+
+  if (!info[0].IsString()) {
+    throw TypeError::New(env, "First argument must be a path");
+  }
+  std::string path = info[0].As<String>();
+
+  const Tree *js_old_tree = nullptr;
+  if (info.Length() > 1 && !info[1].IsNull() && !info[1].IsUndefined()) {
+    js_old_tree = Tree::UnwrapTree(info[1]);
+    if (js_old_tree == nullptr) {
+      throw TypeError::New(env, "Second argument must be a tree");
+    }
+  }
+
+  TSInputEncoding encoding = EncodingFromJS(info[2], TSInputEncodingUTF8);
+  bool map = info[3].IsBoolean() && info[3].As<Boolean>();
+  encoding_ = encoding;
+
+  const TSTree *old_tree = reusable_tree(js_old_tree, encoding);
+  Cancellation cancellation = Cancellation::FromJS(info[4], info[5]);
+  auto *worker = new ParseWorker(env, this, old_tree, std::move(path), encoding, map, std::move(cancellation));
+  Napi::Promise promise = worker->GetPromise();
+  worker->Queue();
+  return promise;
+}
+
+// Parse for at most `budgetMicros`, returning the tree if the parse finished
+// and undefined if it was halted. The input is copied once, when the parse
+// starts, and later calls resume the halted parse from that copy unless
+// `restart` is set.
+Napi::Value Parser::ParseSlice(const CallbackInfo &info) {
+  Napi::Env env = info.Env();
+  EnsureIdle(env);
+
+  if (!info[2].IsNumber()) {
+    throw TypeError::New(env, "Budget must be a number of microseconds");
+  }
+  bool restart = info[4].IsBoolean() && info[4].As<Boolean>();
+
+  if (restart || !slice_input_) {
+    if (!info[0].IsString() && !IsByteArray(info[0])) {
+      throw TypeError::New(env, "Input must be a string or a Buffer");
+    }
+
+    const Tree *js_old_tree = nullptr;
+    if (info.Length() > 1 && !info[1].IsNull() && !info[1].IsUndefined()) {
+      js_old_tree = Tree::UnwrapTree(info[1]);
+      if (js_old_tree == nullptr) {
+        throw TypeError::New(env, "Second argument must be a tree");
+      }
+    }
+
+    std::unique_ptr<TextInput> input = TextInputFromJS(info[0], info[3], js_old_tree, false);
+    if (!input) {
+      return env.Null();
+    }
+    DiscardSlice();
+    const TSTree *old_tree = reusable_tree(js_old_tree, input->Encoding());
+    slice_old_tree_ = old_tree != nullptr ? ts_tree_copy(old_tree) : nullptr;
+    slice_input_ = std::move(input);
+  }
+
+  auto budget_micros = static_cast<uint64_t>(std::max(0.0, info[2].As<Number>().DoubleValue()));
+  ParseProgress progress(Cancellation::AfterMicros(budget_micros), env.Undefined());
+  TSTree *tree = parse_input(parser_, slice_old_tree_, slice_input_->Input(), &progress, &slice_sample_);
+  encoding_ = slice_input_->Encoding();
+
+  if (tree == nullptr && ts_parser_language(parser_) != nullptr) {
+    return env.Undefined();
+  }
+
+  // The parse finished, so there's nothing left to resume.
+  RecordSample(slice_sample_);
+  slice_sample_ = {};
+  slice_input_.reset();
+  ts_tree_delete(slice_old_tree_);
+  slice_old_tree_ = nullptr;
+  return Tree::NewInstance(env, tree, encoding_);
+}
+
+Napi::Value Parser::ParseMany(const CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  if (language_methods::UnwrapLanguage(info[0]) == nullptr) {
+    throw TypeError::New(env, "First argument must be a language");
+  }
+  if (!info[1].IsArray()) {
+    throw TypeError::New(env, "Second argument must be an array");
+  }
+
+  auto js_inputs = info[1].As<Array>();
+  std::vector<TextInput> inputs;
+  inputs.reserve(js_inputs.Length());
+  for (uint32_t i = 0; i < js_inputs.Length(); i++) {
+    Napi::Value js_input = js_inputs[i];
+    if (!js_input.IsString() && !IsByteArray(js_input)) {
+      throw TypeError::New(env, "Inputs must be strings or Buffers");
+    }
+    std::unique_ptr<TextInput> input = TextInputFromJS(js_input, info[3], nullptr, false);
+    if (!input) {
+      return env.Undefined();
+    }
+    inputs.push_back(std::move(*input));
+  }
+
+  unsigned concurrency = std::thread::hardware_concurrency();
+  if (info[2].IsNumber()) {
+    concurrency = info[2].As<Number>().Uint32Value();
+  }
+  concurrency = std::max(1U, std::min<unsigned>(concurrency, inputs.size()));
+
+  return ParseManyJob::Start(env, info[0], std::move(inputs), concurrency);
+}
+
+void Parser::RecordSample(const ParseSample &sample) {
+  stats_.Add(sample);
+  RecordProcessSample(sample);
+}
+
+// Totals for every parse by this parser, along with the most recent one.
+Napi::Value Parser::Stats(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+  Object result = stats_.ToJS(env);
+  result["lastParse"] = stats_.ParseCount() == 0 ? env.Null() : Napi::Value(ParseSampleToJS(env, stats_.Last()));
+  return result;
+}
+
+// Totals for every parse by any parser in the process, including the parsers
+// used by `parseMany`.
+Napi::Value Parser::ProcessStats(const Napi::CallbackInfo &info) {
+  return ProcessStatsToJS(info.Env());
 }
 
 Napi::Value Parser::IncludedRanges(const Napi::CallbackInfo &info) {
   Napi::Env env = info.Env();
+  EnsureIdle(env);
   uint32_t count;
   const TSRange *ranges = ts_parser_included_ranges(parser_, &count);
 
   Napi::Array result = Napi::Array::New(env, count);
   for (uint32_t i = 0; i < count; i++) {
-    result[i] = RangeToJS(env, ranges[i]);
+    result[i] = RangeToJS(env, ranges[i], encoding_);
   }
 
   return result;
 }
 
 Napi::Value Parser::TimeoutMicros(const Napi::CallbackInfo &info) {
+  EnsureIdle(info.Env());
   uint64_t timeout_micros = ts_parser_timeout_micros(parser_);
   return Number::New(info.Env(), static_cast<double>(timeout_micros));
 }
 
 Napi::Value Parser::SetTimeoutMicros(const Napi::CallbackInfo &info) {
+  EnsureIdle(info.Env());
   uint64_t timeout_micros;
   if (!info[0].IsNumber()) {
     throw TypeError::New(info.Env(), "First argument must be a number");
@@ -273,27 +836,39 @@ Napi::Value Parser::SetTimeoutMicros(const Napi::CallbackInfo &info) {
 }
 
 Napi::Value Parser::GetLogger(const Napi::CallbackInfo &info) {
+  EnsureIdle(info.Env());
   TSLogger current_logger = ts_parser_logger(parser_);
   if ((current_logger.payload != nullptr) && current_logger.log == Logger::Log) {
     auto *logger = static_cast<Logger *>(current_logger.payload);
     return logger->func.Value();
   }
+  if (current_logger.log == LogBuffer::Log) {
+    return log_buffer_ref_.Value();
+  }
   return info.Env().Null();
 }
 
-Napi::Value Parser::SetLogger(const Napi::CallbackInfo &info) {
+void Parser::ClearLogger() {
   TSLogger current_logger = ts_parser_logger(parser_);
+  if (current_logger.payload != nullptr && current_logger.log == Logger::Log) {
+    delete static_cast<Logger *>(current_logger.payload);
+  }
+  log_buffer_ref_.Reset();
+  ts_parser_set_logger(parser_, { nullptr, nullptr });
+}
+
+Napi::Value Parser::SetLogger(const Napi::CallbackInfo &info) {
+  EnsureIdle(info.Env());
 
   if (info[0].IsFunction()) {
-    if (current_logger.payload != nullptr) {
-      delete static_cast<Logger *>(current_logger.payload);
-    }
+    ClearLogger();
     ts_parser_set_logger(parser_, Logger::Make(info[0].As<Function>()));
+  } else if (LogBuffer *log_buffer = LogBuffer::UnwrapLogBuffer(info[0])) {
+    ClearLogger();
+    log_buffer_ref_ = Napi::Persistent(info[0].As<Object>());
+    ts_parser_set_logger(parser_, log_buffer->Logger());
   } else if (info[0].IsEmpty() || info[0].IsUndefined() || info[0].IsNull() || (info[0].IsBoolean() && !info[0].As<Boolean>())) {
-    if (current_logger.payload != nullptr) {
-      delete static_cast<Logger *>(current_logger.payload);
-    }
-    ts_parser_set_logger(parser_, { nullptr, nullptr });
+    ClearLogger();
   } else {
     throw TypeError::New(info.Env(), "Logger callback must either be a function or a falsy value");
   }
@@ -302,6 +877,7 @@ Napi::Value Parser::SetLogger(const Napi::CallbackInfo &info) {
 }
 
 Napi::Value Parser::PrintDotGraphs(const Napi::CallbackInfo &info) {
+  EnsureIdle(info.Env());
   bool should_print = true;
   int fd = fileno(stderr);
 
@@ -325,8 +901,34 @@ Napi::Value Parser::PrintDotGraphs(const Napi::CallbackInfo &info) {
 }
 
 Napi::Value Parser::Reset(const Napi::CallbackInfo & info) {
+  EnsureIdle(info.Env());
+  DiscardSlice();
   ts_parser_reset(parser_);
   return info.This();
 }
 
+Napi::Value Parser::GetCache(const Napi::CallbackInfo &info) {
+  if (cache_ == nullptr) {
+    return info.Env().Null();
+  }
+  return cache_ref_.Value();
+}
+
+Napi::Value Parser::SetCache(const Napi::CallbackInfo &info) {
+  EnsureIdle(info.Env());
+  if (info[0].IsUndefined() || info[0].IsNull()) {
+    cache_ = nullptr;
+    cache_ref_.Reset();
+    return info.This();
+  }
+
+  ParseCache *cache = ParseCache::UnwrapCache(info[0]);
+  if (cache == nullptr) {
+    throw TypeError::New(info.Env(), "Cache must be a ParseCache");
+  }
+  cache_ = cache;
+  cache_ref_ = Napi::Persistent(info[0].As<Object>());
+  return info.This();
+}
+
 } // namespace node_tree_sitter
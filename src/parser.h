@@ -1,13 +1,18 @@
 #ifndef NODE_TREE_SITTER_PARSER_H_
 #define NODE_TREE_SITTER_PARSER_H_
 
+#include "./parse_stats.h"
 #include "tree_sitter/api.h"
 
+#include <memory>
 #include <napi.h>
 #include <node_object_wrap.h>
 
 namespace node_tree_sitter {
 
+class ParseCache;
+class TextInput;
+
 class Parser final : public Napi::ObjectWrap<Parser> {
  public:
   static void Init(Napi::Env env, Napi::Object exports);
@@ -16,10 +21,35 @@ class Parser final : public Napi::ObjectWrap<Parser> {
   ~Parser() final;
 
 private:
+  friend class ParseWorker;
+
   TSParser *parser_;
+  TSInputEncoding encoding_ = TSInputEncodingUTF16LE;
+  bool is_parsing_async_ = false;
+  ParseCache *cache_ = nullptr;
+  Napi::ObjectReference cache_ref_;
+  Napi::ObjectReference log_buffer_ref_;
+
+  // The input and old tree of a time-sliced parse that has been halted and
+  // can be resumed by the next call to `parseSlice`.
+  std::unique_ptr<TextInput> slice_input_;
+  TSTree *slice_old_tree_ = nullptr;
+  ParseSample slice_sample_;
+
+  ParseStats stats_;
+
+  void EnsureIdle(Napi::Env env) const;
+  void DiscardSlice();
+  void RecordSample(const ParseSample &sample);
+  void ClearLogger();
 
   Napi::Value SetLanguage(const Napi::CallbackInfo &);
   Napi::Value Parse(const Napi::CallbackInfo &);
+  Napi::Value ParseAsync(const Napi::CallbackInfo &);
+  Napi::Value ParseFile(const Napi::CallbackInfo &);
+  Napi::Value ParseFileAsync(const Napi::CallbackInfo &);
+  Napi::Value ParseSlice(const Napi::CallbackInfo &);
+  static Napi::Value ParseMany(const Napi::CallbackInfo &);
   Napi::Value IncludedRanges(const Napi::CallbackInfo &info);
   Napi::Value SetIncludedRanges(const Napi::CallbackInfo &info);
   Napi::Value TimeoutMicros(const Napi::CallbackInfo &info);
@@ -28,6 +58,10 @@ private:
   Napi::Value SetLogger(const Napi::CallbackInfo &);
   Napi::Value PrintDotGraphs(const Napi::CallbackInfo &);
   Napi::Value Reset(const Napi::CallbackInfo &info);
+  Napi::Value GetCache(const Napi::CallbackInfo &info);
+  Napi::Value SetCache(const Napi::CallbackInfo &info);
+  Napi::Value Stats(const Napi::CallbackInfo &info);
+  static Napi::Value ProcessStats(const Napi::CallbackInfo &info);
 };
 
 } // namespace node_tree_sitter
@@ -1,4 +1,6 @@
 #include "./query.h"
+#include "./cancellation.h"
+#include "./conversions.h"
 #include "./language.h"
 #include "./node.h"
 
@@ -31,25 +33,39 @@ const char *query_error_names[] = {
   "TSQueryErrorStructure",
 };
 
-class CallbackProgress final {
+// Decides on each progress tick whether to halt a query. The cancellation
+// flag and deadline are checked natively, and the JS callback, if there is
+// one, is only called when neither has fired. The cursor keeps a pointer to
+// the options, so this must outlive the iteration over the results.
+class QueryProgress final {
  public:
-  static TSQueryCursorOptions Make(const Napi::Function &func) {
-    TSQueryCursorOptions options;
-    auto *callback = new CallbackProgress();
-    callback->func = Napi::Persistent(func);
-    options.payload = static_cast<void *>(callback);
+  QueryProgress(Cancellation cancellation, const Napi::Value &callback) : cancellation(std::move(cancellation)) {
+    if (callback.IsFunction()) {
+      func = Napi::Persistent(callback.As<Function>());
+    }
+    options.payload = static_cast<void *>(this);
     options.progress_callback = Cancel;
-    return options;
   }
 
+  bool IsEnabled() const { return cancellation.IsEnabled() || !func.IsEmpty(); }
+
+  TSQueryCursorOptions options;
+
   private:
+  Cancellation cancellation;
   Napi::FunctionReference func;
 
   static bool Cancel(TSQueryCursorState *state) {
-    auto *callback = static_cast<CallbackProgress *>(state->payload);
-    Env env = callback->func.Env();
+    auto *progress = static_cast<QueryProgress *>(state->payload);
+    if (progress->cancellation.IsCancelled()) {
+      return true;
+    }
+    if (progress->func.IsEmpty()) {
+      return false;
+    }
+    Env env = progress->func.Env();
     Number index = Number::New(env, state->current_byte_offset);
-    return callback->func({ index }).As<Boolean>();
+    return progress->func({ index }).As<Boolean>();
   }
 };
 
@@ -118,6 +134,15 @@ Query::Query(const Napi::CallbackInfo &info) : Napi::ObjectWrap<Query>(info) , q
     throw Error::New(env, message.c_str());
   }
 
+  // Capture names are returned with every match, so they're created once.
+  uint32_t capture_count = ts_query_capture_count(query_);
+  capture_names_.reserve(capture_count);
+  for (uint32_t i = 0; i < capture_count; i++) {
+    uint32_t length = 0;
+    const char *name = ts_query_capture_name_for_id(query_, i, &length);
+    capture_names_.push_back(Napi::Persistent(String::New(env, name, length)));
+  }
+
   info.This().As<Napi::Object>().Get("_init").As<Napi::Function>().Call(info.This(), {});
 }
 
@@ -197,23 +222,28 @@ Napi::Value Query::Matches(const Napi::CallbackInfo &info) {
   uint32_t start_row = 0, start_column = 0, end_row = 0, end_column = 0, start_index = 0, end_index = 0,
              match_limit = UINT32_MAX, max_start_depth = UINT32_MAX, timeout_micros = 0;
 
+  if (tree == nullptr) {
+    throw Error::New(env, "Missing argument tree");
+  }
+  uint32_t bytes_per_character = BytesPerCharacter(tree->encoding_);
+
   if (info.Length() > 1 && info[1].IsNumber()) {
     start_row = info[1].As<Number>().Uint32Value();
   }
   if (info.Length() > 2 && info[2].IsNumber()) {
-    start_column = info[2].As<Number>().Uint32Value() << 1;
+    start_column = info[2].As<Number>().Uint32Value() * bytes_per_character;
   }
   if (info.Length() > 3 && info[3].IsNumber()) {
     end_row = info[3].As<Number>().Uint32Value();
   }
   if (info.Length() > 4 && info[4].IsNumber()) {
-    end_column = info[4].As<Number>().Uint32Value() << 1;
+    end_column = info[4].As<Number>().Uint32Value() * bytes_per_character;
   }
   if (info.Length() > 5 && info[5].IsNumber()) {
-    start_index = info[5].As<Number>().Uint32Value();
+    start_index = info[5].As<Number>().Uint32Value() * bytes_per_character;
   }
   if (info.Length() > 6 && info[6].IsNumber()) {
-    end_index = info[6].As<Number>().Uint32Value() << 1;
+    end_index = info[6].As<Number>().Uint32Value() * bytes_per_character;
   }
   if (info.Length() > 7 && info[7].IsNumber()) {
     match_limit = info[7].As<Number>().Uint32Value();
@@ -229,10 +259,6 @@ Napi::Value Query::Matches(const Napi::CallbackInfo &info) {
     throw Error::New(env, "Missing argument query");
   }
 
-  if (tree == nullptr) {
-    throw Error::New(env, "Missing argument tree");
-  }
-
   TSQuery *ts_query = query->query_;
   TSNode root_node = node_methods::UnmarshalNode(env, tree);
   TSPoint start_point = {start_row, start_column};
@@ -242,9 +268,9 @@ Napi::Value Query::Matches(const Napi::CallbackInfo &info) {
   ts_query_cursor_set_match_limit(data->ts_query_cursor, match_limit);
   ts_query_cursor_set_max_start_depth(data->ts_query_cursor, max_start_depth);
   ts_query_cursor_set_timeout_micros(data->ts_query_cursor, timeout_micros);
-  if (info.Length() > 10 && info[10].IsFunction()) {
-    TSQueryCursorOptions options = CallbackProgress::Make(info[10].As<Function>());
-    ts_query_cursor_exec_with_options(data->ts_query_cursor, ts_query, root_node, &options);
+  QueryProgress progress(Cancellation::FromJS(info[11], info[12]), info[10]);
+  if (progress.IsEnabled()) {
+    ts_query_cursor_exec_with_options(data->ts_query_cursor, ts_query, root_node, &progress.options);
   } else {
     ts_query_cursor_exec(data->ts_query_cursor, ts_query, root_node);
   }
@@ -260,15 +286,10 @@ Napi::Value Query::Matches(const Napi::CallbackInfo &info) {
     for (uint16_t i = 0; i < match.capture_count; i++) {
       const TSQueryCapture &capture = match.captures[i];
 
-      uint32_t capture_name_len = 0;
-      const char *capture_name = ts_query_capture_name_for_id(
-          ts_query, capture.index, &capture_name_len);
-
       TSNode node = capture.node;
       nodes.push_back(node);
 
-      String js_capture = String::New(env, capture_name);;
-      js_matches[index++] = js_capture;
+      js_matches[index++] = query->capture_names_[capture.index].Value();
     }
   }
 
@@ -289,23 +310,28 @@ Napi::Value Query::Captures(const Napi::CallbackInfo &info) {
   uint32_t start_row = 0, start_column = 0, end_row = 0, end_column = 0, start_index = 0, end_index = 0,
              match_limit = UINT32_MAX, max_start_depth = UINT32_MAX, timeout_micros = 0;
 
+  if (tree == nullptr) {
+    throw Error::New(env, "Missing argument tree");
+  }
+  uint32_t bytes_per_character = BytesPerCharacter(tree->encoding_);
+
   if (info.Length() > 1 && info[1].IsNumber()) {
     start_row = info[1].As<Number>().Uint32Value();
   }
   if (info.Length() > 2 && info[2].IsNumber()) {
-    start_column = info[2].As<Number>().Uint32Value() << 1;
+    start_column = info[2].As<Number>().Uint32Value() * bytes_per_character;
   }
   if (info.Length() > 3 && info[3].IsNumber()) {
     end_row = info[3].As<Number>().Uint32Value();
   }
   if (info.Length() > 4 && info[4].IsNumber()) {
-    end_column = info[4].As<Number>().Uint32Value() << 1;
+    end_column = info[4].As<Number>().Uint32Value() * bytes_per_character;
   }
   if (info.Length() > 5 && info[5].IsNumber()) {
-    start_index = info[5].As<Number>().Uint32Value();
+    start_index = info[5].As<Number>().Uint32Value() * bytes_per_character;
   }
   if (info.Length() > 6 && info[6].IsNumber()) {
-    end_index = info[6].As<Number>().Uint32Value() << 1;
+    end_index = info[6].As<Number>().Uint32Value() * bytes_per_character;
   }
   if (info.Length() > 7 && info[7].IsNumber()) {
     match_limit = info[7].As<Number>().Uint32Value();
@@ -321,10 +347,6 @@ Napi::Value Query::Captures(const Napi::CallbackInfo &info) {
     throw Error::New(env, "Missing argument query");
   }
 
-  if (tree == nullptr) {
-    throw Error::New(env, "Missing argument tree");
-  }
-
   TSQuery *ts_query = query->query_;
   TSNode root_node = node_methods::UnmarshalNode(env, tree);
   TSPoint start_point = {start_row, start_column};
@@ -334,7 +356,12 @@ Napi::Value Query::Captures(const Napi::CallbackInfo &info) {
   ts_query_cursor_set_match_limit(data->ts_query_cursor, match_limit);
   ts_query_cursor_set_max_start_depth(data->ts_query_cursor, max_start_depth);
   ts_query_cursor_set_timeout_micros(data->ts_query_cursor, timeout_micros);
-  ts_query_cursor_exec(data->ts_query_cursor, ts_query, root_node);
+  QueryProgress progress(Cancellation::FromJS(info[11], info[12]), info[10]);
+  if (progress.IsEnabled()) {
+    ts_query_cursor_exec_with_options(data->ts_query_cursor, ts_query, root_node, &progress.options);
+  } else {
+    ts_query_cursor_exec(data->ts_query_cursor, ts_query, root_node);
+  }
 
   Array js_matches = Array::New(env);
   unsigned index = 0;
@@ -354,15 +381,10 @@ Napi::Value Query::Captures(const Napi::CallbackInfo &info) {
     for (uint16_t i = 0; i < match.capture_count; i++) {
       const TSQueryCapture &capture = match.captures[i];
 
-      uint32_t capture_name_len = 0;
-      const char *capture_name = ts_query_capture_name_for_id(
-          ts_query, capture.index, &capture_name_len);
-
       TSNode node = capture.node;
       nodes.push_back(node);
 
-      String js_capture = String::New(env, capture_name);;
-      js_matches[index++] = js_capture;
+      js_matches[index++] = query->capture_names_[capture.index].Value();
     }
   }
 
@@ -6,6 +6,7 @@
 
 #include <napi.h>
 #include <node_object_wrap.h>
+#include <vector>
 
 namespace node_tree_sitter {
 
@@ -17,8 +18,11 @@ class Query final : public Napi::ObjectWrap<Query> {
   explicit Query(const Napi::CallbackInfo &info);
   ~Query() final;
 
+  const TSQuery *GetTSQuery() const { return query_; }
+
  private:
   TSQuery *query_;
+  std::vector<Napi::Reference<Napi::String>> capture_names_;
 
   Napi::Value New(const Napi::CallbackInfo &);
   Napi::Value Matches(const Napi::CallbackInfo &);
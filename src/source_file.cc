@@ -0,0 +1,153 @@
+#include "./source_file.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <system_error>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace node_tree_sitter {
+
+namespace {
+
+std::string describe_error(const std::string &path) {
+  // Unlike strerror, this is safe to call from worker threads.
+  return "Failed to read " + path + ": " + std::generic_category().message(errno);
+}
+
+} // namespace
+
+std::shared_ptr<SourceFile> SourceFile::FromString(std::string contents) {
+  std::shared_ptr<SourceFile> file(new SourceFile());
+  file->contents_ = std::move(contents);
+  return file;
+}
+
+std::shared_ptr<SourceFile> SourceFile::Lazy(std::function<std::string()> load) {
+  std::shared_ptr<SourceFile> file(new SourceFile());
+  file->load_ = std::move(load);
+  return file;
+}
+
+void SourceFile::Load() const {
+  std::call_once(loaded_, [this] {
+    if (load_) {
+      contents_ = load_();
+      load_ = nullptr;
+    }
+  });
+}
+
+#ifndef _WIN32
+
+namespace {
+
+// Read the whole file with pread, which isn't affected by the file's offset
+// and can be retried after an interruption. A file that changes size while
+// it's read yields whatever was there when each read happened.
+bool read_file(int fd, size_t size_hint, std::string *contents) {
+  // The spare byte lets the read that finds the end of an unchanged file
+  // happen without growing the buffer.
+  contents->resize(size_hint + 1);
+  size_t length = 0;
+  for (;;) {
+    if (length == contents->size()) {
+      contents->resize(contents->size() * 2);
+    }
+    ssize_t count = pread(fd, &(*contents)[length], contents->size() - length, static_cast<off_t>(length));
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    if (count == 0) {
+      break;
+    }
+    length += static_cast<size_t>(count);
+  }
+  contents->resize(length);
+  return true;
+}
+
+} // namespace
+
+std::shared_ptr<SourceFile> SourceFile::Open(const std::string &path, bool map, std::string *error) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    *error = describe_error(path);
+    return nullptr;
+  }
+
+  struct stat info {};
+  if (fstat(fd, &info) != 0) {
+    *error = describe_error(path);
+    close(fd);
+    return nullptr;
+  }
+
+  std::shared_ptr<SourceFile> file(new SourceFile());
+  auto size = static_cast<size_t>(info.st_size);
+  if (!map) {
+    if (!read_file(fd, size, &file->contents_)) {
+      *error = describe_error(path);
+      close(fd);
+      return nullptr;
+    }
+  } else if (size > 0) {
+    void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      *error = describe_error(path);
+      close(fd);
+      return nullptr;
+    }
+    file->data_ = static_cast<const char *>(data);
+    file->size_ = size;
+  }
+
+  close(fd);
+  return file;
+}
+
+SourceFile::~SourceFile() {
+  if (data_ != nullptr) {
+    munmap(const_cast<char *>(data_), size_);
+  }
+}
+
+#else
+
+// Files are always read into memory here, since there's no mapping to opt into.
+std::shared_ptr<SourceFile> SourceFile::Open(const std::string &path, bool /*map*/, std::string *error) {
+  std::FILE *stream = std::fopen(path.c_str(), "rb");
+  if (stream == nullptr) {
+    *error = describe_error(path);
+    return nullptr;
+  }
+
+  std::shared_ptr<SourceFile> file(new SourceFile());
+  char chunk[64 * 1024];
+  size_t count;
+  while ((count = std::fread(chunk, 1, sizeof(chunk), stream)) > 0) {
+    file->contents_.append(chunk, count);
+  }
+  bool failed = std::ferror(stream) != 0;
+  std::fclose(stream);
+
+  if (failed) {
+    *error = describe_error(path);
+    return nullptr;
+  }
+  return file;
+}
+
+SourceFile::~SourceFile() = default;
+
+#endif
+
+} // namespace node_tree_sitter
@@ -0,0 +1,51 @@
+#ifndef NODE_TREE_SITTER_SOURCE_FILE_H_
+#define NODE_TREE_SITTER_SOURCE_FILE_H_
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace node_tree_sitter {
+
+// The contents of a file on disk, read into memory that the SourceFile owns.
+// Opening doesn't touch JS, so it can be done off the main thread.
+//
+// With `map` set, the file is memory-mapped instead where the platform
+// supports it, which avoids the copy. The mapping then reflects later writes
+// to the file, and truncating the file while it's mapped makes reads past the
+// new end raise SIGBUS, which crashes the process.
+class SourceFile final {
+ public:
+  static std::shared_ptr<SourceFile> Open(const std::string &path, bool map, std::string *error);
+
+  // Text that is already in memory.
+  static std::shared_ptr<SourceFile> FromString(std::string contents);
+
+  // Text that is only built when it's first read, on whichever thread reads
+  // it, such as a snapshot of a document that may never be looked at.
+  static std::shared_ptr<SourceFile> Lazy(std::function<std::string()> load);
+
+  SourceFile(const SourceFile &) = delete;
+  SourceFile &operator=(const SourceFile &) = delete;
+  ~SourceFile();
+
+  const char *Data() const { Load(); return data_ != nullptr ? data_ : contents_.data(); }
+  size_t Size() const { Load(); return data_ != nullptr ? size_ : contents_.size(); }
+
+ private:
+  SourceFile() = default;
+
+  void Load() const;
+
+  const char *data_ = nullptr;
+  size_t size_ = 0;
+  mutable std::string contents_;
+  mutable std::function<std::string()> load_;
+  mutable std::once_flag loaded_;
+};
+
+} // namespace node_tree_sitter
+
+#endif // NODE_TREE_SITTER_SOURCE_FILE_H_
@@ -0,0 +1,128 @@
+#include "./text_diff.h"
+#include "./conversions.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define NODE_TREE_SITTER_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define NODE_TREE_SITTER_NEON
+#endif
+
+namespace node_tree_sitter {
+
+namespace {
+
+// Whether the 16 bytes at `a` and `b` are equal.
+inline bool equal_block(const char *a, const char *b) {
+#if defined(NODE_TREE_SITTER_SSE2)
+  __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a));
+  __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b));
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) == 0xFFFF;
+#elif defined(NODE_TREE_SITTER_NEON)
+  uint8x16_t x = vld1q_u8(reinterpret_cast<const uint8_t *>(a));
+  uint8x16_t y = vld1q_u8(reinterpret_cast<const uint8_t *>(b));
+  return vminvq_u8(vceqq_u8(x, y)) == 0xFF;
+#else
+  uint64_t x[2];
+  uint64_t y[2];
+  std::memcpy(x, a, sizeof(x));
+  std::memcpy(y, b, sizeof(y));
+  return x[0] == y[0] && x[1] == y[1];
+#endif
+}
+
+// The two scans compare 16 bytes at a time until they reach a block that
+// differs, then finish byte by byte.
+size_t common_prefix_length(const char *a, const char *b, size_t length) {
+  size_t i = 0;
+  while (i + 16 <= length && equal_block(a + i, b + i)) {
+    i += 16;
+  }
+  while (i < length && a[i] == b[i]) {
+    i++;
+  }
+  return i;
+}
+
+size_t common_suffix_length(const char *a_end, const char *b_end, size_t length) {
+  size_t i = 0;
+  while (i + 16 <= length && equal_block(a_end - i - 16, b_end - i - 16)) {
+    i += 16;
+  }
+  while (i < length && a_end[-1 - static_cast<ptrdiff_t>(i)] == b_end[-1 - static_cast<ptrdiff_t>(i)]) {
+    i++;
+  }
+  return i;
+}
+
+// Whether a character starts at the given byte, rather than in the middle of
+// a multi-byte UTF-8 sequence or between the halves of a surrogate pair.
+bool is_character_boundary(const char *text, size_t length, size_t byte, TSInputEncoding encoding) {
+  if (byte == 0 || byte >= length) {
+    return true;
+  }
+  if (encoding == TSInputEncodingUTF8) {
+    return (static_cast<uint8_t>(text[byte]) & 0xC0) != 0x80;
+  }
+  if (byte % 2 != 0) {
+    return false;
+  }
+  uint16_t unit = static_cast<uint8_t>(text[byte]) | (static_cast<uint8_t>(text[byte + 1]) << 8);
+  return unit < 0xDC00 || unit > 0xDFFF;
+}
+
+// Advance a point over the given text. Columns are counted in bytes.
+TSPoint advance_point(TSPoint point, const char *text, size_t length, TSInputEncoding encoding) {
+  size_t unit = BytesPerCharacter(encoding);
+  const char *line_start = text;
+  for (size_t i = 0; i + unit <= length; i += unit) {
+    if (text[i] == '\n' && (unit == 1 || text[i + 1] == 0)) {
+      point.row++;
+      line_start = text + i + unit;
+    }
+  }
+  if (line_start != text) {
+    point.column = 0;
+  }
+  point.column += static_cast<uint32_t>(text + length - line_start);
+  return point;
+}
+
+} // namespace
+
+TSInputEdit ComputeEdit(
+  const char *old_text,
+  size_t old_length,
+  const char *new_text,
+  size_t new_length,
+  TSInputEncoding encoding
+) {
+  size_t shorter = std::min(old_length, new_length);
+  size_t prefix = common_prefix_length(old_text, new_text, shorter);
+  while (!is_character_boundary(old_text, old_length, prefix, encoding) ||
+         !is_character_boundary(new_text, new_length, prefix, encoding)) {
+    prefix--;
+  }
+
+  size_t suffix = common_suffix_length(old_text + old_length, new_text + new_length, shorter - prefix);
+  while (!is_character_boundary(old_text, old_length, old_length - suffix, encoding) ||
+         !is_character_boundary(new_text, new_length, new_length - suffix, encoding)) {
+    suffix--;
+  }
+
+  TSInputEdit edit;
+  edit.start_byte = static_cast<uint32_t>(prefix);
+  edit.old_end_byte = static_cast<uint32_t>(old_length - suffix);
+  edit.new_end_byte = static_cast<uint32_t>(new_length - suffix);
+  edit.start_point = advance_point({0, 0}, old_text, prefix, encoding);
+  edit.old_end_point = advance_point(edit.start_point, old_text + prefix, edit.old_end_byte - prefix, encoding);
+  edit.new_end_point = advance_point(edit.start_point, new_text + prefix, edit.new_end_byte - prefix, encoding);
+  return edit;
+}
+
+} // namespace node_tree_sitter
@@ -0,0 +1,23 @@
+#ifndef NODE_TREE_SITTER_TEXT_DIFF_H_
+#define NODE_TREE_SITTER_TEXT_DIFF_H_
+
+#include "tree_sitter/api.h"
+
+#include <cstddef>
+
+namespace node_tree_sitter {
+
+// Describe the change from one text to another as a single edit, covering
+// everything between their common prefix and their common suffix. The edit
+// never splits a character in the given encoding.
+TSInputEdit ComputeEdit(
+  const char *old_text,
+  size_t old_length,
+  const char *new_text,
+  size_t new_length,
+  TSInputEncoding encoding
+);
+
+} // namespace node_tree_sitter
+
+#endif // NODE_TREE_SITTER_TEXT_DIFF_H_
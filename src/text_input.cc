@@ -0,0 +1,246 @@
+#include "./text_input.h"
+#include "./conversions.h"
+#include "./tree.h"
+
+#include <algorithm>
+#include <cstring>
+#include <napi.h>
+#include <string>
+
+using namespace Napi;
+
+namespace node_tree_sitter {
+
+const char * TextInput::Read(void *payload, uint32_t byte, TSPoint /*position*/, uint32_t *bytes_read) {
+  auto *input = static_cast<TextInput *>(payload);
+  size_t length = input->Length();
+  if (byte >= length) {
+    *bytes_read = 0;
+    return "";
+  }
+  *bytes_read = length - byte;
+  return input->Data() + byte;
+}
+
+namespace {
+
+size_t utf8_sequence_length(unsigned char lead) {
+  if ((lead & 0xE0) == 0xC0) return 2;
+  if ((lead & 0xF0) == 0xE0) return 3;
+  if ((lead & 0xF8) == 0xF0) return 4;
+  return 1;
+}
+
+// Whether a little-endian UTF-16 code unit, given its high byte, is the first
+// half of a surrogate pair.
+bool is_high_surrogate(unsigned char high_byte) {
+  return (high_byte & 0xFC) == 0xD8;
+}
+
+// The length of the longest prefix of `data` that doesn't end partway
+// through a character. `data` must start at a character boundary.
+size_t complete_length(const char *data, size_t length, TSInputEncoding encoding) {
+  if (encoding == TSInputEncodingUTF8) {
+    for (size_t lead = length; lead > 0 && length - lead < 4;) {
+      lead--;
+      auto byte = static_cast<unsigned char>(data[lead]);
+      if ((byte & 0xC0) != 0x80) {
+        return lead + utf8_sequence_length(byte) > length ? lead : length;
+      }
+    }
+    return length;
+  }
+
+  size_t units = length & ~static_cast<size_t>(1);
+  if (units >= 2 && is_high_surrogate(static_cast<unsigned char>(data[units - 1]))) {
+    return units - 2;
+  }
+  return units;
+}
+
+} // namespace
+
+const char * ChunkedInput::Read(void *payload, uint32_t byte, TSPoint /*position*/, uint32_t *bytes_read) {
+  auto *input = static_cast<ChunkedInput *>(payload);
+  if (byte >= input->total_length) {
+    *bytes_read = 0;
+    return "";
+  }
+  auto it = std::upper_bound(input->starts.begin(), input->starts.end(), byte);
+  size_t index = (it - input->starts.begin()) - 1;
+  size_t offset = byte - input->starts[index];
+  const char *data = input->ChunkData(index) + offset;
+  size_t length = complete_length(data, input->chunks[index].length - offset, input->encoding);
+  if (length > 0) {
+    *bytes_read = length;
+    return data;
+  }
+  *bytes_read = input->CopyCharacter(index, offset);
+  return input->scratch;
+}
+
+// Copy the character starting at `offset` in the given chunk, which continues
+// into the chunks after it, into the scratch buffer. Returns its length, which
+// is short if the text ends partway through the character.
+size_t ChunkedInput::CopyCharacter(size_t index, size_t offset) {
+  size_t length = 0;
+  for (; index < chunks.size() && length < sizeof(scratch); index++, offset = 0) {
+    size_t count = std::min(chunks[index].length - offset, sizeof(scratch) - length);
+    std::memcpy(scratch + length, ChunkData(index) + offset, count);
+    length += count;
+  }
+
+  size_t character_length;
+  if (encoding == TSInputEncodingUTF8) {
+    character_length = utf8_sequence_length(static_cast<unsigned char>(scratch[0]));
+  } else {
+    character_length = length >= 2 && is_high_surrogate(static_cast<unsigned char>(scratch[1])) ? 4 : 2;
+  }
+  return std::min(character_length, length);
+}
+
+namespace {
+
+// Copy a string of `length` code units in the given encoding into native
+// memory. The buffer has room for the null terminator that N-API writes.
+bool copy_string(const Napi::Value &value, TSInputEncoding encoding, size_t length, std::string *text) {
+  napi_status status;
+  if (encoding == TSInputEncodingUTF8) {
+    text->resize(length + 1);
+    status = napi_get_value_string_utf8(value.Env(), value, &(*text)[0], length + 1, &length);
+  } else {
+    text->resize((length + 1) * sizeof(char16_t));
+    status = napi_get_value_string_utf16(
+      value.Env(), value, reinterpret_cast<char16_t *>(&(*text)[0]), length + 1, &length
+    );
+  }
+  if (status != napi_ok) {
+    return false;
+  }
+  text->resize(length * BytesPerCharacter(encoding));
+  return true;
+}
+
+bool string_length(const Napi::Value &value, TSInputEncoding encoding, size_t *length) {
+  napi_status status = encoding == TSInputEncodingUTF8
+    ? napi_get_value_string_utf8(value.Env(), value, nullptr, 0, length)
+    : napi_get_value_string_utf16(value.Env(), value, nullptr, 0, length);
+  return status == napi_ok;
+}
+
+// Copy a string into native memory in a single pass. Strings that are pure
+// ASCII are copied as UTF-8, which uses half the memory of UTF-16 and still
+// keeps byte offsets equal to JS string indices. Anything else is copied as
+// UTF-16, unless `allow_utf8` is false, in which case UTF-16 is always used.
+bool string_from_js(const Napi::Value &value, bool allow_utf8, std::string *text, TSInputEncoding *encoding) {
+  size_t length = 0;
+  if (!string_length(value, TSInputEncodingUTF16LE, &length)) {
+    return false;
+  }
+
+  *encoding = TSInputEncodingUTF16LE;
+  if (allow_utf8) {
+    // Every non-ASCII UTF-16 code unit takes at least two bytes in UTF-8, so
+    // the lengths only match when the string is entirely ASCII.
+    size_t utf8_length = 0;
+    if (!string_length(value, TSInputEncodingUTF8, &utf8_length)) {
+      return false;
+    }
+    if (utf8_length == length) {
+      *encoding = TSInputEncodingUTF8;
+    }
+  }
+
+  return copy_string(value, *encoding, length, text);
+}
+
+} // namespace
+
+bool StringFromJS(const Napi::Value &value, TSInputEncoding encoding, std::string *text) {
+  size_t length = 0;
+  return string_length(value, encoding, &length) && copy_string(value, encoding, length, text);
+}
+
+bool IsByteArray(const Napi::Value &value) {
+  return value.IsTypedArray() && value.As<TypedArray>().TypedArrayType() == napi_uint8_array;
+}
+
+TSInputEncoding EncodingFromJS(const Napi::Value &value, TSInputEncoding default_encoding) {
+  if (value.IsUndefined() || value.IsNull()) {
+    return default_encoding;
+  }
+  if (value.IsString()) {
+    std::string name = value.As<String>();
+    if (name == "utf8" || name == "utf-8") {
+      return TSInputEncodingUTF8;
+    }
+    if (name == "utf16le" || name == "utf-16le") {
+      return TSInputEncodingUTF16LE;
+    }
+  }
+  throw TypeError::New(value.Env(), "Encoding must be 'utf8' or 'utf16le'");
+}
+
+std::unique_ptr<TextInput> TextInputFromJS(
+  const Napi::Value &value,
+  const Napi::Value &js_encoding,
+  const Tree *old_tree,
+  bool borrow
+) {
+  if (value.IsString()) {
+    bool allow_utf8 = old_tree == nullptr || old_tree->encoding_ == TSInputEncodingUTF8;
+    std::string text;
+    TSInputEncoding encoding;
+    if (!string_from_js(value, allow_utf8, &text, &encoding)) {
+      return nullptr;
+    }
+    return std::make_unique<TextInput>(std::move(text), encoding);
+  }
+
+  if (IsByteArray(value)) {
+    TSInputEncoding encoding = EncodingFromJS(js_encoding, TSInputEncodingUTF16LE);
+    auto bytes = value.As<Uint8Array>();
+    const char *data = reinterpret_cast<const char *>(bytes.Data());
+    if (borrow) {
+      return std::make_unique<TextInput>(data, bytes.ByteLength(), encoding);
+    }
+    return std::make_unique<TextInput>(std::string(data, bytes.ByteLength()), encoding);
+  }
+
+  return nullptr;
+}
+
+std::unique_ptr<ChunkedInput> ChunkedInputFromJS(
+  const Napi::Array &js_chunks,
+  const Napi::Value &js_encoding,
+  bool borrow
+) {
+  Napi::Env env = js_chunks.Env();
+  TSInputEncoding encoding = EncodingFromJS(js_encoding, TSInputEncodingUTF16LE);
+  auto input = std::make_unique<ChunkedInput>(encoding);
+
+  for (uint32_t i = 0; i < js_chunks.Length(); i++) {
+    Napi::Value js_chunk = js_chunks[i];
+    if (js_chunk.IsString()) {
+      std::string text;
+      if (!StringFromJS(js_chunk, encoding, &text)) {
+        return nullptr;
+      }
+      input->AddChunk(std::move(text));
+    } else if (IsByteArray(js_chunk)) {
+      auto bytes = js_chunk.As<Uint8Array>();
+      const char *data = reinterpret_cast<const char *>(bytes.Data());
+      if (borrow) {
+        input->AddChunk(data, bytes.ByteLength());
+      } else {
+        input->AddChunk(std::string(data, bytes.ByteLength()));
+      }
+    } else {
+      throw TypeError::New(env, "Chunks must be strings or Buffers");
+    }
+  }
+
+  return input;
+}
+
+} // namespace node_tree_sitter
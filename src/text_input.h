@@ -0,0 +1,151 @@
+#ifndef NODE_TREE_SITTER_TEXT_INPUT_H_
+#define NODE_TREE_SITTER_TEXT_INPUT_H_
+
+#include "tree_sitter/api.h"
+
+#include <cstddef>
+#include <memory>
+#include <napi.h>
+#include <string>
+#include <vector>
+
+namespace node_tree_sitter {
+
+class Tree;
+
+// Input text that lives in native memory, so that it can be read without
+// calling back into JS (and therefore off the main thread). The text is either
+// owned, or borrowed from a byte array that outlives a synchronous parse.
+class TextInput final {
+  public:
+  TextInput(std::string text, TSInputEncoding encoding) : text(std::move(text)), encoding(encoding) {}
+
+  TextInput(const char *data, size_t length, TSInputEncoding encoding)
+    : encoding(encoding), borrowed_data(data), borrowed_length(length) {}
+
+  TSInput Input() {
+    TSInput result;
+    result.payload = static_cast<void *>(this);
+    result.encoding = encoding;
+    result.read = Read;
+    result.decode = nullptr;
+    return result;
+  }
+
+  TSInputEncoding Encoding() const { return encoding; }
+  const char *Data() const { return borrowed_data != nullptr ? borrowed_data : text.data(); }
+  size_t Length() const { return borrowed_data != nullptr ? borrowed_length : text.size(); }
+
+  // Move out owned text, or copy borrowed text, once the input has been read.
+  std::string TakeText() {
+    return borrowed_data != nullptr ? std::string(borrowed_data, borrowed_length) : std::move(text);
+  }
+
+  private:
+  static const char * Read(void *payload, uint32_t byte, TSPoint position, uint32_t *bytes_read);
+
+  std::string text;
+  TSInputEncoding encoding;
+  const char *borrowed_data = nullptr;
+  size_t borrowed_length = 0;
+};
+
+// Input text stored as a sequence of chunks, like a rope or a piece table.
+// Reads binary search for the chunk containing the requested byte and return
+// the rest of that chunk, so a parse never calls back into JS. A character
+// that straddles two chunks is copied into a scratch buffer and returned on
+// its own, since the lexer can't decode half of one.
+class ChunkedInput final {
+  public:
+  explicit ChunkedInput(TSInputEncoding encoding) : encoding(encoding) {}
+
+  void AddChunk(std::string text) {
+    if (!text.empty()) {
+      AddChunk(nullptr, text.size());
+      chunks.back().owned = std::move(text);
+    }
+  }
+
+  void AddChunk(const char *data, size_t length) {
+    if (length == 0) {
+      return;
+    }
+    chunks.push_back({{}, data, length});
+    starts.push_back(total_length);
+    total_length += length;
+  }
+
+  TSInput Input() {
+    TSInput result;
+    result.payload = static_cast<void *>(this);
+    result.encoding = encoding;
+    result.read = Read;
+    result.decode = nullptr;
+    return result;
+  }
+
+  // Copy the chunks into one contiguous text.
+  std::string Text() const {
+    std::string result;
+    result.reserve(total_length);
+    for (const Chunk &chunk : chunks) {
+      result.append(chunk.data != nullptr ? chunk.data : chunk.owned.data(), chunk.length);
+    }
+    return result;
+  }
+
+  private:
+  struct Chunk {
+    std::string owned;
+    const char *data;
+    size_t length;
+  };
+
+  static const char * Read(void *payload, uint32_t byte, TSPoint position, uint32_t *bytes_read);
+
+  const char *ChunkData(size_t index) const {
+    return chunks[index].data != nullptr ? chunks[index].data : chunks[index].owned.data();
+  }
+
+  size_t CopyCharacter(size_t index, size_t offset);
+
+  TSInputEncoding encoding;
+  std::vector<Chunk> chunks;
+  std::vector<size_t> starts;
+  size_t total_length = 0;
+  char scratch[4] = {};
+};
+
+bool IsByteArray(const Napi::Value &value);
+
+// Copy a string into native memory, transcoded to the given encoding.
+bool StringFromJS(const Napi::Value &value, TSInputEncoding encoding, std::string *text);
+
+// Read an encoding name ('utf8' or 'utf16le'), returning the default if the
+// value is undefined.
+TSInputEncoding EncodingFromJS(const Napi::Value &value, TSInputEncoding default_encoding);
+
+// Read a string, or a Buffer/Uint8Array in the given encoding, into a text
+// input. Strings are always copied. Byte arrays are referenced in place when
+// `borrow` is set, and copied otherwise. When reparsing, the old tree's
+// encoding is kept if the new text allows it.
+std::unique_ptr<TextInput> TextInputFromJS(
+  const Napi::Value &value,
+  const Napi::Value &js_encoding,
+  const Tree *old_tree,
+  bool borrow
+);
+
+// Read an array of strings and byte arrays into a chunked input. Byte arrays
+// are referenced in place when `borrow` is set, so the input must not outlive
+// the current call, and copied otherwise. Strings are copied, transcoded to
+// the input's encoding.
+std::unique_ptr<ChunkedInput> ChunkedInputFromJS(
+  const Napi::Array &js_chunks,
+  const Napi::Value &js_encoding,
+  bool borrow
+);
+
+} // namespace node_tree_sitter
+
+#endif // NODE_TREE_SITTER_TEXT_INPUT_H_
@@ -1,9 +1,17 @@
 #include "./tree.h"
 #include "./addon_data.h"
 #include "./conversions.h"
+#include "./language.h"
 #include "./node.h"
+#include "./text_diff.h"
+#include "./text_input.h"
 
+#include <algorithm>
+#include <cstddef>
+#include <mutex>
 #include <napi.h>
+#include <string>
+#include <string_view>
 
 using namespace Napi;
 
@@ -20,13 +28,95 @@ const napi_type_tag TREE_TYPE_TAG = {
   0x8AF2E5212AD58ABF, 0x7FA28BFC1966AC2D
 };
 
-using node_methods::UnmarshalNodeId;
+using language_methods::UnwrapLanguage;
+
+// startIndex, oldEndIndex, newEndIndex, then the row and column of
+// startPosition, oldEndPosition and newEndPosition.
+const size_t EDIT_FIELD_COUNT = 9;
+
+// The edit log is first trimmed once it holds this many edits.
+const size_t kMinEditLogTrimThreshold = 64;
+
+namespace {
+
+// Trees that have been handed off with `_transfer` but not yet adopted by
+// another env. The addon is loaded once per process, so every worker thread
+// sees the same registry. A tree that is never adopted is deleted when the
+// env that transferred it is torn down.
+struct TransferredTree {
+  TSTree *tree;
+  TSInputEncoding encoding;
+  std::shared_ptr<SourceFile> source;
+  napi_env owner;
+};
+
+class TransferRegistry {
+ public:
+  ~TransferRegistry() {
+    for (auto &entry : trees_) {
+      ts_tree_delete(entry.second.tree);
+    }
+  }
+
+  uint32_t Add(TransferredTree tree) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint32_t id = next_id_++;
+    trees_.emplace(id, std::move(tree));
+    return id;
+  }
+
+  // Remove and return the tree with the given id, if its language matches.
+  bool Take(uint32_t id, const TSLanguage *language, TransferredTree *result) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto entry = trees_.find(id);
+    if (entry == trees_.end() || ts_tree_language(entry->second.tree) != language) {
+      return false;
+    }
+    *result = std::move(entry->second);
+    trees_.erase(entry);
+    return true;
+  }
+
+  void DropOwnedBy(napi_env env) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto entry = trees_.begin(); entry != trees_.end();) {
+      if (entry->second.owner == env) {
+        ts_tree_delete(entry->second.tree);
+        entry = trees_.erase(entry);
+      } else {
+        ++entry;
+      }
+    }
+  }
+
+ private:
+  std::mutex mutex_;
+  std::unordered_map<uint32_t, TransferredTree> trees_;
+  uint32_t next_id_ = 1;
+};
+
+TransferRegistry &transfer_registry() {
+  static TransferRegistry registry;
+  return registry;
+}
+
+void drop_transferred_trees(void *env) {
+  transfer_registry().DropOwnedBy(static_cast<napi_env>(env));
+}
+
+} // namespace
 
 void Tree::Init(Napi::Env env, Napi::Object exports) {
   auto *data = env.GetInstanceData<AddonData>();
 
   Function ctor = DefineClass(env, "Tree", {
+    InstanceMethod("copy", &Tree::Copy, napi_default_method),
+    InstanceMethod("_transfer", &Tree::Transfer, napi_default_method),
+    StaticMethod("_adopt", &Tree::Adopt, napi_default_method),
     InstanceMethod("edit", &Tree::Edit, napi_default_method),
+    InstanceMethod("editMany", &Tree::EditMany, napi_default_method),
+    InstanceMethod("_editFromText", &Tree::EditFromText, napi_default_method),
+    StaticMethod("computeEdit", &Tree::ComputeEdit, napi_default_method),
     InstanceMethod("rootNode", &Tree::RootNode, napi_default_method),
     InstanceMethod("rootNodeWithOffset", &Tree::RootNodeWithOffset, napi_default_method),
     InstanceMethod("printDotGraph", &Tree::PrintDotGraph, napi_default_method),
@@ -35,28 +125,41 @@ void Tree::Init(Napi::Env env, Napi::Object exports) {
     InstanceMethod("getEditedRange", &Tree::GetEditedRange, napi_default_method),
     InstanceMethod("_cacheNode", &Tree::CacheNode, napi_default_method),
     InstanceMethod("_cacheNodes", &Tree::CacheNodes, napi_default_method),
+    InstanceMethod("_nodeObjects", &Tree::NodeObjects, napi_default_method),
+    InstanceMethod("getNodeCacheStats", &Tree::GetNodeCacheStats, napi_default_method),
+    InstanceMethod("setNodeCacheCapacity", &Tree::SetNodeCacheCapacity, napi_default_method),
+    InstanceMethod("setValueNodes", &Tree::SetValueNodes, napi_default_method),
+    InstanceMethod("_setGeometryPrefetch", &Tree::SetGeometryPrefetch, napi_default_method),
+    InstanceMethod("_source", &Tree::Source, napi_default_method),
   });
 
   data->tree_constructor = Napi::Persistent(ctor);
   exports["Tree"] = ctor;
+  napi_add_env_cleanup_hook(env, drop_transferred_trees, static_cast<napi_env>(env));
+
+  Napi::Value weak_ref = env.Global()["WeakRef"];
+  Napi::Value weak_ref_prototype = weak_ref.As<Object>()["prototype"];
+  Napi::Value deref_value = weak_ref_prototype.As<Object>()["deref"];
+  data->weak_ref_deref = Napi::Persistent(deref_value.As<Function>());
 }
 
-Tree::Tree(const Napi::CallbackInfo &info) : Napi::ObjectWrap<Tree>(info), tree_(nullptr) {
+Tree::Tree(const Napi::CallbackInfo &info)
+  : Napi::ObjectWrap<Tree>(info), tree_(nullptr), encoding_(TSInputEncodingUTF16LE),
+    edit_log_trim_threshold_(kMinEditLogTrimThreshold) {
   Value().TypeTag(&TREE_TYPE_TAG);
 }
 
 Tree::~Tree() {
   ts_tree_delete(tree_);
-  for (auto &entry : cached_nodes_) {
-    entry.second->tree = nullptr;
-  }
 }
 
-Napi::Value Tree::NewInstance(Napi::Env env, TSTree *tree) {
+Napi::Value Tree::NewInstance(Napi::Env env, TSTree *tree, TSInputEncoding encoding) {
   auto *data = env.GetInstanceData<AddonData>();
   if (tree != nullptr) {
     Object self = data->tree_constructor.New({});
-    Tree::Unwrap(self)->tree_ = tree;
+    Tree *wrapper = Tree::Unwrap(self);
+    wrapper->tree_ = tree;
+    wrapper->encoding_ = encoding;
     return self;
   }
 
@@ -74,6 +177,46 @@ const Tree *Tree::UnwrapTree(const Napi::Value &value) {
   return Tree::Unwrap(js_tree);
 }
 
+// Syntax trees are immutable and reference counted, so a copy is O(1). The
+// copy shares the retained source file, but not the cached nodes or the edit
+// log.
+Napi::Value Tree::Copy(const Napi::CallbackInfo &info) {
+  Napi::Value result = NewInstance(info.Env(), ts_tree_copy(tree_), encoding_);
+  Tree::Unwrap(result.As<Object>())->source_ = source_;
+  return result;
+}
+
+// Copy the tree into the process-wide registry and return a handle with an
+// id that another env can pass to `_adopt`.
+Napi::Value Tree::Transfer(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+  uint32_t id = transfer_registry().Add({ts_tree_copy(tree_), encoding_, source_, env});
+  Object result = Object::New(env);
+  result["handle"] = Number::New(env, id);
+  result["encoding"] = String::New(env, encoding_ == TSInputEncodingUTF8 ? "utf8" : "utf16le");
+  return result;
+}
+
+// Take ownership of a transferred tree. Each id can only be adopted once.
+Napi::Value Tree::Adopt(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+  if (!info[0].IsNumber()) {
+    throw TypeError::New(env, "Invalid tree handle");
+  }
+  const TSLanguage *language = UnwrapLanguage(info[1]);
+  if (language == nullptr) {
+    throw TypeError::New(env, "Invalid language object");
+  }
+
+  TransferredTree transferred;
+  if (!transfer_registry().Take(info[0].As<Number>().Uint32Value(), language, &transferred)) {
+    throw Error::New(env, "The tree handle has already been adopted, or was created for another language");
+  }
+  Napi::Value result = NewInstance(env, transferred.tree, transferred.encoding);
+  Tree::Unwrap(result.As<Object>())->source_ = std::move(transferred.source);
+  return result;
+}
+
 #define read_number_from_js(out, value, name)                                \
   if (!(value).IsNumber()) {                                                   \
     throw TypeError::New(env, name " must be an integer");                   \
@@ -83,7 +226,7 @@ const Tree *Tree::UnwrapTree(const Napi::Value &value) {
 
 #define read_byte_count_from_js(out, value, name)   \
   read_number_from_js(out, value, name);            \
-  (*(out)) *= 2
+  (*(out)) *= BytesPerCharacter(encoding_)
 
 Napi::Value Tree::Edit(const Napi::CallbackInfo &info) {
   Napi::Env env = info.Env();
@@ -99,29 +242,128 @@ Napi::Value Tree::Edit(const Napi::CallbackInfo &info) {
   read_byte_count_from_js(&edit.new_end_byte, info[8], "newEndIndex");
 
   ts_tree_edit(tree_, &edit);
+  LogEdit(edit);
 
-  for (auto &entry : cached_nodes_) {
-    Object js_node = entry.second->node.Value();
-    if (js_node.IsEmpty()) {
-      continue;
-    }
-    TSNode node;
-    node.id = entry.first;
-    for (unsigned i = 0; i < 4; i++) {
-      Napi::Value node_field = js_node[i + 2];
-      if (node_field.IsNumber()) {
-        node.context[i] = node_field.As<Number>().Uint32Value();
-      }
-    }
+  return Number::New(env, static_cast<double>(EditCount()));
+}
+
+// Apply a batch of edits, packed into a Uint32Array with EDIT_FIELD_COUNT
+// fields per edit, and return the number of edits applied to the tree so far.
+Napi::Value Tree::EditMany(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+  if (!info[0].IsTypedArray() || info[0].As<TypedArray>().TypedArrayType() != napi_uint32_array) {
+    throw TypeError::New(env, "Edits must be a Uint32Array");
+  }
+  auto js_fields = info[0].As<Uint32Array>();
+  const uint32_t *fields = js_fields.Data();
+  size_t edit_count = js_fields.ElementLength() / EDIT_FIELD_COUNT;
+  uint32_t bytes_per_character = BytesPerCharacter(encoding_);
+
+  edit_log_.reserve(edit_log_.size() + edit_count);
+  for (size_t i = 0; i < edit_count; i++, fields += EDIT_FIELD_COUNT) {
+    TSInputEdit edit;
+    edit.start_byte = fields[0] * bytes_per_character;
+    edit.old_end_byte = fields[1] * bytes_per_character;
+    edit.new_end_byte = fields[2] * bytes_per_character;
+    edit.start_point = {fields[3], fields[4] * bytes_per_character};
+    edit.old_end_point = {fields[5], fields[6] * bytes_per_character};
+    edit.new_end_point = {fields[7], fields[8] * bytes_per_character};
+    ts_tree_edit(tree_, &edit);
+    LogEdit(edit);
+  }
 
-    ts_node_edit(&node, &edit);
+  return Number::New(env, static_cast<double>(EditCount()));
+}
 
-    for (unsigned i = 0; i < 4; i++) {
-      js_node[i + 2U] = Number::New(env, node.context[i]);
-    }
+namespace {
+
+// Borrow the bytes of a Buffer, or copy a string in the given encoding.
+std::string_view text_from_js(const Napi::Value &value, TSInputEncoding encoding, std::string *storage) {
+  if (IsByteArray(value)) {
+    auto bytes = value.As<Uint8Array>();
+    return {reinterpret_cast<const char *>(bytes.Data()), bytes.ByteLength()};
+  }
+  if (!value.IsString()) {
+    throw TypeError::New(value.Env(), "Text must be a string or a Buffer");
   }
+  if (!StringFromJS(value, encoding, storage)) {
+    throw Error::New(value.Env(), "Failed to read the text");
+  }
+  return *storage;
+}
 
-  return info.This();
+Napi::Object edit_to_js(Napi::Env env, const TSInputEdit &edit, TSInputEncoding encoding) {
+  Object result = Object::New(env);
+  result["startIndex"] = ByteCountToJS(env, edit.start_byte, encoding);
+  result["oldEndIndex"] = ByteCountToJS(env, edit.old_end_byte, encoding);
+  result["newEndIndex"] = ByteCountToJS(env, edit.new_end_byte, encoding);
+  result["startPosition"] = PointToJS(env, edit.start_point, encoding);
+  result["oldEndPosition"] = PointToJS(env, edit.old_end_point, encoding);
+  result["newEndPosition"] = PointToJS(env, edit.new_end_point, encoding);
+  return result;
+}
+
+TSInputEdit compute_edit(const Napi::Value &js_old_text, const Napi::Value &js_new_text, TSInputEncoding encoding) {
+  std::string old_storage;
+  std::string new_storage;
+  std::string_view old_text = text_from_js(js_old_text, encoding, &old_storage);
+  std::string_view new_text = text_from_js(js_new_text, encoding, &new_storage);
+  return ComputeEdit(old_text.data(), old_text.size(), new_text.data(), new_text.size(), encoding);
+}
+
+} // namespace
+
+// Compute the edit that turns one text into another, in the given encoding.
+Napi::Value Tree::ComputeEdit(const Napi::CallbackInfo &info) {
+  TSInputEncoding encoding = EncodingFromJS(info[2], TSInputEncodingUTF16LE);
+  return edit_to_js(info.Env(), compute_edit(info[0], info[1], encoding), encoding);
+}
+
+// Edit the tree to match a new version of its text, and return the edit.
+Napi::Value Tree::EditFromText(const Napi::CallbackInfo &info) {
+  TSInputEdit edit = compute_edit(info[0], info[1], encoding_);
+  ts_tree_edit(tree_, &edit);
+  LogEdit(edit);
+  return edit_to_js(info.Env(), edit, encoding_);
+}
+
+// Record an edit for the nodes handed out before it. Whenever the log has
+// doubled in length, the edits that every live node has already applied are
+// dropped from its front.
+void Tree::LogEdit(const TSInputEdit &edit) {
+  edit_log_.push_back(edit);
+  if (edit_log_.size() < edit_log_trim_threshold_) {
+    return;
+  }
+  size_t oldest = node_cache_.OldestVersion(EditCount());
+  edit_log_.erase(edit_log_.begin(), edit_log_.begin() + static_cast<std::ptrdiff_t>(oldest - edit_log_base_));
+  edit_log_base_ = oldest;
+  edit_log_trim_threshold_ = std::max(kMinEditLogTrimThreshold, 2 * edit_log_.size());
+}
+
+uint32_t Tree::FindOrAddNode(TSNode node) const {
+  return node_cache_.FindOrAdd(node, EditCount());
+}
+
+// Nodes that were handed out before an edit are brought up to date lazily,
+// the next time they are used.
+TSNode Tree::GetNode(uint32_t handle) const {
+  NodeCache::Slot *slot = node_cache_.Get(handle);
+  if (slot == nullptr) {
+    return {{0, 0, 0, 0}, nullptr, tree_};
+  }
+  for (; slot->version < EditCount(); slot->version++) {
+    ts_node_edit(&slot->node, &edit_log_[slot->version - edit_log_base_]);
+  }
+  return slot->node;
+}
+
+// Adjust a node that was current as of `version` edits for every edit since.
+TSNode Tree::ApplyEdits(TSNode node, size_t version) const {
+  for (size_t i = version; i < EditCount(); i++) {
+    ts_node_edit(&node, &edit_log_[i - edit_log_base_]);
+  }
+  return node;
 }
 
 Napi::Value Tree::RootNode(const Napi::CallbackInfo &info) {
@@ -146,13 +388,23 @@ Napi::Value Tree::GetChangedRanges(const Napi::CallbackInfo &info) {
   if (other_tree == nullptr) {
     throw TypeError::New(env, "Argument must be a tree");
   }
+  // A string that gains non-ASCII text is reparsed as UTF-16 without its
+  // UTF-8 old tree, so the two trees' offsets can't be compared. Everything
+  // in the new tree is reported as changed.
+  if (other_tree->encoding_ != encoding_) {
+    TSNode root = ts_tree_root_node(other_tree->tree_);
+    TSRange range = {{0, 0}, ts_node_end_point(root), 0, ts_node_end_byte(root)};
+    Array result = Array::New(env, 1);
+    result[0U] = RangeToJS(env, range, other_tree->encoding_);
+    return result;
+  }
 
   uint32_t range_count;
   TSRange *ranges = ts_tree_get_changed_ranges(tree_, other_tree->tree_, &range_count);
 
   Array result = Array::New(env);
   for (size_t i = 0; i < range_count; i++) {
-    result[i] = RangeToJS(env, ranges[i]);
+    result[i] = RangeToJS(env, ranges[i], encoding_);
   }
 
   free(ranges);
@@ -167,7 +419,7 @@ Napi::Value Tree::GetIncludedRanges(const Napi::CallbackInfo &info) {
 
   Array result = Array::New(env);
   for (size_t i = 0; i < range_count; i++) {
-    result[i] = RangeToJS(env, ranges[i]);
+    result[i] = RangeToJS(env, ranges[i], encoding_);
   }
 
   free(ranges);
@@ -227,7 +479,7 @@ Napi::Value Tree::GetEditedRange(const Napi::CallbackInfo &info) {
   }
 
   ts_tree_cursor_delete(&cursor);
-  return RangeToJS(env, result);
+  return RangeToJS(env, result, encoding_);
 }
 
 Napi::Value Tree::PrintDotGraph(const Napi::CallbackInfo &info) {
@@ -246,50 +498,19 @@ Napi::Value Tree::PrintDotGraph(const Napi::CallbackInfo &info) {
 
 namespace {
 
-void FinalizeNode(Napi::Env _env, Tree::NodeCacheEntry *cache_entry) {
-  assert(!cache_entry->node.IsEmpty());
-  cache_entry->node.Reset();
-  if (cache_entry->tree != nullptr) {
-    assert(cache_entry->tree->cached_nodes_.count(cache_entry->key));
-    cache_entry->tree->cached_nodes_.erase(cache_entry->key);
-  }
-  delete cache_entry;
-}
-
-void CacheNodeForTree(Tree *tree, Napi::Env _env, Object js_node) {
-  Value js_node_field1 = js_node[0U];
-  Value js_node_field2 = js_node[1U];
-  if (!js_node_field1.IsNumber() || !js_node_field2.IsNumber()) {
-    return;
-  }
-  uint32_t key_parts[2] = {
-    js_node_field1.As<Number>().Uint32Value(),
-    js_node_field2.As<Number>().Uint32Value(),
-  };
-  const void *key = UnmarshalNodeId(key_parts);
-
-  // A Node could have been garbage collected but the finalizer has not yet run to remove its cache entry
-  if (tree->cached_nodes_.count(key)) {
-    return;
+void CacheNodeForTree(const Tree *tree, Napi::Env env, const Napi::Value &js_handle) {
+  if (!js_handle.IsNumber()) {
+    throw TypeError::New(env, "Invalid node handle");
   }
-
-  auto *cache_entry = new Tree::NodeCacheEntry{tree, key, {}};
-  cache_entry->node = Napi::Weak(js_node);
-  js_node.AddFinalizer(&FinalizeNode, cache_entry);
-
-  tree->cached_nodes_[key] = cache_entry;
+  tree->node_cache_.SetObject(js_handle.As<Number>().Uint32Value());
 }
 
 } // namespace
 
+// Index a node whose object JS has stored in the array of node objects.
 Napi::Value Tree::CacheNode(const Napi::CallbackInfo &info) {
   Napi::Env env = info.Env();
-
-  if (!info[0].IsObject()) {
-    throw TypeError::New(env, "not an object");
-  }
-
-  CacheNodeForTree(this, env, info[0].As<Object>());
+  CacheNodeForTree(this, env, info[0]);
   return env.Undefined();
 }
 
@@ -299,18 +520,72 @@ Napi::Value Tree::CacheNodes(const Napi::CallbackInfo &info) {
   if (!info[0].IsArray()) {
     throw TypeError::New(env, "not an array");
   }
-  auto js_nodes = info[0].As<Array>();
-  uint32_t length = js_nodes.Length();
+  auto js_handles = info[0].As<Array>();
+  uint32_t length = js_handles.Length();
 
   for (uint32_t i = 0; i < length; ++i) {
-    Napi::Value js_node = js_nodes[i];
-    if (!js_node.IsObject()) {
-      throw TypeError::New(env, "not an object");
-    }
-    CacheNodeForTree(this, env, js_node.As<Object>());
+    CacheNodeForTree(this, env, js_handles[i]);
   }
 
   return env.Undefined();
 }
 
+Napi::Value Tree::NodeObjects(const Napi::CallbackInfo &info) {
+  return node_cache_.Objects(info.Env());
+}
+
+Napi::Value Tree::GetNodeCacheStats(const Napi::CallbackInfo &info) {
+  Napi::Object result = node_cache_.Stats(info.Env());
+  result["pendingEdits"] = Number::New(info.Env(), static_cast<double>(edit_log_.size()));
+  return result;
+}
+
+// Cap the number of nodes whose objects can be found again by id. A null
+// capacity removes the cap.
+Napi::Value Tree::SetNodeCacheCapacity(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+  if (info[0].IsNull() || info[0].IsUndefined()) {
+    node_cache_.SetMaxIndexed(SIZE_MAX);
+  } else if (info[0].IsNumber() && info[0].As<Number>().DoubleValue() >= 0) {
+    node_cache_.SetMaxIndexed(static_cast<size_t>(info[0].As<Number>().Int64Value()));
+  } else {
+    throw TypeError::New(env, "Capacity must be a non-negative number");
+  }
+  return info.This();
+}
+
+Napi::Value Tree::SetValueNodes(const Napi::CallbackInfo &info) {
+  if (!info[0].IsBoolean()) {
+    throw TypeError::New(info.Env(), "First argument must be a boolean");
+  }
+  value_nodes_ = info[0].As<Boolean>();
+  return info.This();
+}
+
+Napi::Value Tree::SetGeometryPrefetch(const Napi::CallbackInfo &info) {
+  if (!info[0].IsBoolean()) {
+    throw TypeError::New(info.Env(), "First argument must be a boolean");
+  }
+  prefetch_geometry_ = info[0].As<Boolean>();
+  return info.This();
+}
+
+// Returns a Buffer over the retained source file, without copying it where
+// external buffers are allowed. The Buffer keeps the file mapped.
+Napi::Value Tree::Source(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+  if (!source_) {
+    return env.Undefined();
+  }
+
+  auto *hint = new std::shared_ptr<SourceFile>(source_);
+  return Buffer<char>::NewOrCopy(
+    env,
+    const_cast<char *>(source_->Data()),
+    source_->Size(),
+    [](Napi::Env, char *, std::shared_ptr<SourceFile> *file) { delete file; },
+    hint
+  );
+}
+
 } // namespace node_tree_sitter
@@ -2,34 +2,69 @@
 #define NODE_TREE_SITTER_TREE_H_
 
 #include "./addon_data.h"
+#include "./node_cache.h"
+#include "./source_file.h"
 #include "tree_sitter/api.h"
 
+#include <memory>
 #include <napi.h>
 #include <node_object_wrap.h>
-#include <unordered_map>
+#include <vector>
 
 namespace node_tree_sitter {
 
 class Tree final : public Napi::ObjectWrap<Tree> {
  public:
   static void Init(Napi::Env env, Napi::Object exports);
-  static Napi::Value NewInstance(Napi::Env env, TSTree *tree);
+  static Napi::Value NewInstance(Napi::Env env, TSTree *tree, TSInputEncoding encoding);
   static const Tree *UnwrapTree(const Napi::Value &value);
 
   explicit Tree(const Napi::CallbackInfo &);
   ~Tree() final;
 
-  struct NodeCacheEntry {
-    Tree *tree;
-    const void *key;
-    Napi::ObjectReference node;
-  };
+  uint32_t FindOrAddNode(TSNode node) const;
+  TSNode GetNode(uint32_t handle) const;
+  TSNode ApplyEdits(TSNode node, size_t version) const;
+
+  // The number of edits ever applied to the tree, which is the version of a
+  // node that is up to date.
+  size_t EditCount() const { return edit_log_base_ + edit_log_.size(); }
 
   TSTree *tree_;
-  std::unordered_map<const void *, NodeCacheEntry *> cached_nodes_;
+  TSInputEncoding encoding_;
+  std::shared_ptr<SourceFile> source_;
+
+  // The edits applied to the tree that some live node may not have applied
+  // yet, in order, so that nodes handed out before an edit can be adjusted
+  // when they are next used. The first one is edit number `edit_log_base_`.
+  std::vector<TSInputEdit> edit_log_;
+  size_t edit_log_base_ = 0;
+  size_t edit_log_trim_threshold_;
+
+  // The nodes that JS holds, by the handle stored in each SyntaxNode. Handing
+  // out a node doesn't change the tree itself, so the cache is mutable.
+  mutable NodeCache node_cache_;
+
+  // Whether nodes are handed out as values, which skip the node cache and so
+  // aren't guaranteed to be the same object when the same node is returned
+  // twice. Value nodes carry their own version, and aren't taken into account
+  // when the edit log is trimmed, so a value node that is older than the log
+  // can no longer be used.
+  bool value_nodes_ = false;
+
+  // Whether a node's type id and position are transferred along with it.
+  bool prefetch_geometry_ = false;
 
  private:
+  void LogEdit(const TSInputEdit &edit);
+
+  Napi::Value Copy(const Napi::CallbackInfo &info);
+  Napi::Value Transfer(const Napi::CallbackInfo &info);
+  static Napi::Value Adopt(const Napi::CallbackInfo &info);
   Napi::Value Edit(const Napi::CallbackInfo &info);
+  Napi::Value EditMany(const Napi::CallbackInfo &info);
+  Napi::Value EditFromText(const Napi::CallbackInfo &info);
+  static Napi::Value ComputeEdit(const Napi::CallbackInfo &info);
   Napi::Value RootNode(const Napi::CallbackInfo &info);
   Napi::Value RootNodeWithOffset(const Napi::CallbackInfo &info);
   Napi::Value PrintDotGraph(const Napi::CallbackInfo &info);
@@ -38,6 +73,12 @@ class Tree final : public Napi::ObjectWrap<Tree> {
   Napi::Value GetIncludedRanges(const Napi::CallbackInfo &info);
   Napi::Value CacheNode(const Napi::CallbackInfo &info);
   Napi::Value CacheNodes(const Napi::CallbackInfo &info);
+  Napi::Value NodeObjects(const Napi::CallbackInfo &info);
+  Napi::Value GetNodeCacheStats(const Napi::CallbackInfo &info);
+  Napi::Value SetNodeCacheCapacity(const Napi::CallbackInfo &info);
+  Napi::Value SetValueNodes(const Napi::CallbackInfo &info);
+  Napi::Value SetGeometryPrefetch(const Napi::CallbackInfo &info);
+  Napi::Value Source(const Napi::CallbackInfo &info);
 };
 
 } // namespace node_tree_sitter
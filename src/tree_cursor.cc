@@ -45,15 +45,18 @@ void TreeCursor::Init(Napi::Env env, Napi::Object exports) {
   data->tree_cursor_constructor = Napi::Persistent(ctor);
 }
 
-Napi::Value TreeCursor::NewInstance(Napi::Env env, TSTreeCursor cursor) {
+Napi::Value TreeCursor::NewInstance(Napi::Env env, TSTreeCursor cursor, TSInputEncoding encoding) {
   auto *data = env.GetInstanceData<AddonData>();
 
   Object self = data->tree_cursor_constructor.New({});
-  TreeCursor::Unwrap(self)->cursor_ = cursor;
+  TreeCursor *wrapper = TreeCursor::Unwrap(self);
+  wrapper->cursor_ = cursor;
+  wrapper->encoding_ = encoding;
   return self;
 }
 
-TreeCursor::TreeCursor(const Napi::CallbackInfo& info) : Napi::ObjectWrap<TreeCursor>(info), cursor_() {}
+TreeCursor::TreeCursor(const Napi::CallbackInfo& info)
+  : Napi::ObjectWrap<TreeCursor>(info), cursor_(), encoding_(TSInputEncodingUTF16LE) {}
 
 TreeCursor::~TreeCursor() { ts_tree_cursor_delete(&cursor_); }
 
@@ -98,7 +101,7 @@ Napi::Value TreeCursor::GotoFirstChildForIndex(const Napi::CallbackInfo &info) {
     throw TypeError::New(env, "First argument must be an integer");
   }
   auto index = info[0].As<Number>();
-  uint32_t goal_byte = index.Uint32Value() * 2;
+  uint32_t goal_byte = index.Uint32Value() * BytesPerCharacter(encoding_);
   int64_t child_index = ts_tree_cursor_goto_first_child_for_byte(&cursor_, goal_byte);
   if (child_index < 0) {
     return env.Null();
@@ -109,7 +112,7 @@ Napi::Value TreeCursor::GotoFirstChildForIndex(const Napi::CallbackInfo &info) {
 
 Napi::Value TreeCursor::GotoFirstChildForPosition(const Napi::CallbackInfo &info) {
   Napi::Env env = info.Env();
-  Napi::Maybe<TSPoint> goal_point = PointFromJS(info[0].As<Object>());
+  Napi::Maybe<TSPoint> goal_point = PointFromJS(info[0].As<Object>(), encoding_);
   if (goal_point.IsNothing()) {
     throw TypeError::New(env, "First argument must be a Point object");
   }
@@ -122,13 +125,13 @@ Napi::Value TreeCursor::GotoFirstChildForPosition(const Napi::CallbackInfo &info
 
 Napi::Value TreeCursor::StartPosition(const Napi::CallbackInfo &info) {
   TSNode node = ts_tree_cursor_current_node(&cursor_);
-  TransferPoint(info.Env(), ts_node_start_point(node));
+  TransferPoint(info.Env(), ts_node_start_point(node), encoding_);
   return info.Env().Undefined();
 }
 
 Napi::Value TreeCursor::EndPosition(const Napi::CallbackInfo &info) {
   TSNode node = ts_tree_cursor_current_node(&cursor_);
-  TransferPoint(info.Env(), ts_node_end_point(node));
+  TransferPoint(info.Env(), ts_node_end_point(node), encoding_);
   return info.Env().Undefined();
 }
 
@@ -146,14 +149,15 @@ Napi::Value TreeCursor::Reset(const Napi::CallbackInfo &info) {
 }
 
 Napi::Value TreeCursor::ResetTo(const Napi::CallbackInfo &info) {
-  TSTreeCursor other_cursor = TreeCursor::Unwrap(info[0].As<Object>())->cursor_;
-  ts_tree_cursor_reset_to(&cursor_, &other_cursor);
+  TreeCursor *other = TreeCursor::Unwrap(info[0].As<Object>());
+  ts_tree_cursor_reset_to(&cursor_, &other->cursor_);
+  encoding_ = other->encoding_;
   return info.Env().Undefined();
 }
 
 Napi::Value TreeCursor::NodeType(const Napi::CallbackInfo &info) {
   TSNode node = ts_tree_cursor_current_node(&cursor_);
-  return String::New(info.Env(), ts_node_type(node));;
+  return NameToJS(info.Env(), ts_node_type(node));
 }
 
 Napi::Value TreeCursor::NodeTypeId(const Napi::CallbackInfo &info) {
@@ -187,7 +191,7 @@ Napi::Value TreeCursor::CurrentFieldId(const Napi::CallbackInfo &info) {
 Napi::Value TreeCursor::CurrentFieldName(const Napi::CallbackInfo &info) {
   const char *field_name = ts_tree_cursor_current_field_name(&cursor_);
   if (field_name != nullptr) {
-    return String::New(info.Env(), field_name);
+    return NameToJS(info.Env(), field_name);
   }
   return info.Env().Undefined();
 }
@@ -202,12 +206,12 @@ Napi::Value TreeCursor::CurrentDescendantIndex(const Napi::CallbackInfo &info) {
 
 Napi::Value TreeCursor::StartIndex(const Napi::CallbackInfo &info) {
   TSNode node = ts_tree_cursor_current_node(&cursor_);
-  return ByteCountToJS(info.Env(), ts_node_start_byte(node));
+  return ByteCountToJS(info.Env(), ts_node_start_byte(node), encoding_);
 }
 
 Napi::Value TreeCursor::EndIndex(const Napi::CallbackInfo &info) {
   TSNode node = ts_tree_cursor_current_node(&cursor_);
-  return ByteCountToJS(info.Env(), ts_node_end_byte(node));
+  return ByteCountToJS(info.Env(), ts_node_end_byte(node), encoding_);
 }
 
 } // namespace node_tree_sitter
@@ -12,12 +12,13 @@ namespace node_tree_sitter {
 class TreeCursor final : public Napi::ObjectWrap<TreeCursor> {
  public:
   static void Init(Napi::Env env, Napi::Object exports);
-  static Napi::Value NewInstance(Napi::Env Env, TSTreeCursor);
+  static Napi::Value NewInstance(Napi::Env Env, TSTreeCursor, TSInputEncoding);
 
   explicit TreeCursor(const Napi::CallbackInfo &);
   ~TreeCursor() final;
 
   TSTreeCursor cursor_;
+  TSInputEncoding encoding_;
 
  private:
   Napi::Value GotoFirstChild(const Napi::CallbackInfo &);
@@ -0,0 +1,116 @@
+/// <reference path="../tree-sitter.d.ts" />
+/** @type {typeof import("tree-sitter")} */
+const Parser = require("../index.js");
+const HTML = require('tree-sitter-html');
+const JavaScript = require('tree-sitter-javascript');
+const assert = require('node:assert');
+const { describe, it } = require('node:test');
+
+describe("Document", () => {
+  it("parses its initial text", () => {
+    const document = new Parser.Document(JavaScript, "let x = 1;");
+    assert.equal(document.getText(), "let x = 1;");
+    assert.equal(document.getEncoding(), "utf16le");
+    assert.equal(document.tree.language, JavaScript);
+    assert.equal(document.tree.rootNode.toString(),
+      "(program (lexical_declaration (variable_declarator name: (identifier) value: (number))))");
+  });
+
+  describe(".applyTextEdits", () => {
+    it("edits the text and reparses the tree", () => {
+      const document = new Parser.Document(JavaScript, "let x = 1;\nconsole.log(x);");
+      const oldTree = document.tree;
+      const tree = document.applyTextEdits([
+        { range: { startIndex: 0, endIndex: 3 }, text: "const" },
+        { range: { startPosition: { row: 1, column: 12 }, endPosition: { row: 1, column: 13 } }, text: "[x, 'ä']" },
+      ]);
+
+      assert.equal(document.getText(), "const x = 1;\nconsole.log([x, 'ä']);");
+      assert.equal(document.tree, tree);
+      assert.equal(tree.rootNode.text, document.getText());
+      assert.equal(tree.rootNode.child(1).firstChild.lastChild.text, "([x, 'ä'])");
+      assert.equal(tree.rootNode.hasError, false);
+
+      // The old tree still describes the old text.
+      assert.equal(oldTree.rootNode.text, "let x = 1;\nconsole.log(x);");
+      assert.deepEqual(tree.getChangedRanges(oldTree).length > 0, true);
+    });
+
+    it("keeps the text of trees from many edits ago", () => {
+      const document = new Parser.Document(JavaScript, "f();");
+      const trees = [document.tree];
+      let text = "f();";
+      for (let i = 0; i < 600; i++) {
+        document.applyTextEdits([{ range: { startIndex: 1, endIndex: 1 }, text: String(i % 10) }]);
+        text = text.slice(0, 1) + (i % 10) + text.slice(1);
+        if (i % 100 === 0) trees.push([document.tree, text]);
+      }
+
+      assert.equal(trees[0].rootNode.text, "f();");
+      for (const [tree, expected] of trees.slice(1)) {
+        assert.equal(tree.rootNode.text, expected);
+      }
+      assert.equal(document.tree.rootNode.text, text);
+    });
+
+    it("computes positions in UTF-8 documents", () => {
+      const document = new Parser.Document(JavaScript, "f('ä');\ng();", "utf8");
+      const tree = document.applyTextEdits([
+        { range: { startPosition: { row: 1, column: 0 }, endPosition: { row: 1, column: 1 } }, text: "hh" },
+      ]);
+      assert.equal(document.getText(), "f('ä');\nhh();");
+      const call = tree.rootNode.child(1).firstChild;
+      assert.equal(call.text, "hh()");
+      assert.deepEqual(call.startPosition, { row: 1, column: 0 });
+      assert.equal(call.startIndex, 9);
+    });
+
+    it("reparses only the injected layers whose text changed", () => {
+      const injections = [{ language: JavaScript, query: new Parser.Query(HTML, "(script_element (raw_text) @injection.content)") }];
+      const text = "<script>a();</script>\n<p>hi</p>\n<script>b();</script>";
+      const document = new Parser.Document(HTML, text, "utf16le", injections);
+
+      let layers = document.getLayers();
+      assert.deepEqual(layers.map((layer) => layer.tree.rootNode.text), ["a();", "b();"]);
+      assert.equal(layers[0].language, JavaScript);
+      assert.equal(layers[0].depth, 1);
+      assert.equal(layers[1].tree.rootNode.firstChild.type, "expression_statement");
+      const [aRootId, bRootId] = layers.map((layer) => layer.tree.rootNode.id);
+
+      const bStart = text.indexOf("b();");
+      document.applyTextEdits([{ range: { startIndex: bStart, endIndex: bStart + 1 }, text: "ccc" }]);
+      layers = document.getLayers();
+      assert.deepEqual(layers.map((layer) => layer.tree.rootNode.text), ["a();", "ccc();"]);
+      assert.equal(layers[1].range.startIndex, bStart);
+
+      // The first layer's tree was taken over as is, while the second was reparsed.
+      assert.equal(layers[0].tree.rootNode.id, aRootId);
+      assert.equal(layers[0].tree.rootNode.hasChanges, false);
+      assert.notEqual(layers[1].tree.rootNode.id, bRootId);
+    });
+
+    it("applies none of the edits when one is invalid", () => {
+      const document = new Parser.Document(JavaScript, "a;\nc;");
+      const tree = document.tree;
+      assert.throws(() => document.applyTextEdits([
+        { range: { startIndex: 0, endIndex: 1 }, text: "bb\nb" },
+        { range: { startIndex: 3, endIndex: 5 }, text: "d" },
+        { range: { startIndex: 9, endIndex: 20 }, text: "e" },
+      ]), RangeError);
+      assert.equal(document.getText(), "a;\nc;");
+      assert.equal(document.tree, tree);
+
+      document.applyTextEdits([{ range: { startPosition: { row: 1, column: 0 }, endPosition: { row: 1, column: 1 } }, text: "d" }]);
+      assert.equal(document.getText(), "a;\nd;");
+      assert.equal(document.tree.rootNode.text, "a;\nd;");
+    });
+
+    it("clamps a position past the end of a line to just before its newline", () => {
+      const document = new Parser.Document(JavaScript, "ab\ncd");
+      document.applyTextEdits([
+        { range: { startPosition: { row: 0, column: 10 }, endPosition: { row: 0, column: 10 } }, text: ";" },
+      ]);
+      assert.equal(document.getText(), "ab;\ncd");
+    });
+  });
+});
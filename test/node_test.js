@@ -94,6 +94,118 @@ describe("Node", () => {
     })
   });
 
+  describe("handles", () => {
+    it("gives every node the same shape and returns one object per node", () => {
+      const tree = parser.parse("a(b, b); c;");
+      const nodes = getAllNodes(tree);
+      for (const node of nodes) {
+        assert.deepEqual(Object.keys(node), ["tree"]);
+      }
+
+      const call = tree.rootNode.firstChild.firstChild;
+      const args = call.lastChild.namedChildren;
+      assert.equal(args.length, 2);
+      assert.notEqual(args[0], args[1]);
+      assert.equal(args[0], call.lastChild.namedChild(0));
+      assert.equal(args[0].parent.parent, call);
+      assert.equal(call.descendantsOfType("identifier").length, 3);
+    });
+
+    it("keeps evicted nodes usable when the tree's node cache is capped", () => {
+      const tree = parser.parse("a; b; c; d;");
+      tree.setNodeCacheCapacity(2);
+      const statements = tree.rootNode.namedChildren;
+      assert.deepEqual(statements.map((node) => node.text), ["a;", "b;", "c;", "d;"]);
+
+      const stats = tree.getNodeCacheStats();
+      assert.equal(stats.indexed, 2);
+      assert.equal(stats.maxIndexed, 2);
+      assert.ok(stats.evictions >= 3);
+      assert.ok(stats.nodes >= 5);
+
+      const again = tree.rootNode.namedChildren;
+      assert.equal(again[3], statements[3]);
+      assert.notEqual(again[0], statements[0]);
+      assert.equal(again[0].text, "a;");
+      assert.equal(statements[0].nextSibling.text, "b;");
+
+      tree.setNodeCacheCapacity(null);
+      assert.equal(tree.getNodeCacheStats().maxIndexed, null);
+    });
+
+    it("keeps returning the same objects for live nodes across sweeps", () => {
+      const tree = parser.parse("x;".repeat(3000));
+      const statements = tree.rootNode.namedChildren;
+      const again = tree.rootNode.namedChildren;
+      assert.ok(tree.getNodeCacheStats().sweeps > 0);
+      assert.ok(again.every((node, i) => node === statements[i]));
+      assert.equal(again[2999].previousSibling, statements[2998]);
+    });
+
+    it("answers position getters from prefetched geometry until the tree is edited", () => {
+      const tree = parser.parse("a;\nfoo(b);", null, { prefetchGeometry: true });
+      const call = tree.rootNode.lastChild.firstChild;
+      const args = call.lastChild.namedChildren;
+      assert.equal(call.typeId, tree.rootNode.lastChild.firstChild.typeId);
+      assert.deepEqual(call.startPosition, { row: 1, column: 0 });
+      assert.deepEqual(call.endPosition, { row: 1, column: 6 });
+      assert.equal(args[0].startIndex, 7);
+      assert.equal(args[0].endIndex, 8);
+
+      tree.edit({
+        startIndex: 0,
+        oldEndIndex: 0,
+        newEndIndex: 2,
+        startPosition: { row: 0, column: 0 },
+        oldEndPosition: { row: 0, column: 0 },
+        newEndPosition: { row: 0, column: 2 },
+      });
+      assert.equal(args[0].startIndex, 9);
+      assert.deepEqual(call.startPosition, { row: 1, column: 0 });
+      assert.equal(tree.rootNode.firstChild.endIndex, 4);
+    });
+
+    it("hands out value nodes without caching them", () => {
+      const tree = parser.parse("a(b, b); c;", null, { valueNodes: true });
+      const call = tree.rootNode.firstChild.firstChild;
+      assert.equal(call.type, "call_expression");
+      assert.notEqual(tree.rootNode.firstChild.firstChild, call);
+      assert.deepEqual(call.lastChild.namedChildren.map((node) => node.text), ["b", "b"]);
+      assert.equal(call.descendantsOfType("identifier").length, 3);
+      assert.equal(call.parent.parent.type, "program");
+      assert.equal(tree.getNodeCacheStats().nodes, 0);
+
+      tree.edit({
+        startIndex: 0,
+        oldEndIndex: 0,
+        newEndIndex: 2,
+        startPosition: { row: 0, column: 0 },
+        oldEndPosition: { row: 0, column: 0 },
+        newEndPosition: { row: 0, column: 2 },
+      });
+      assert.equal(call.startIndex, 2);
+      assert.equal(call.nextSibling.startIndex, 9);
+    });
+
+    it("keeps trimming the edit log once value nodes have been handed out", () => {
+      const tree = parser.parse("a;", null, { valueNodes: true });
+      const statement = tree.rootNode.firstChild;
+      for (let i = 0; i < 100; i++) {
+        tree.edit({
+          startIndex: 0,
+          oldEndIndex: 0,
+          newEndIndex: 1,
+          startPosition: { row: 0, column: 0 },
+          oldEndPosition: { row: 0, column: 0 },
+          newEndPosition: { row: 0, column: 1 },
+        });
+      }
+      assert.ok(tree.getNodeCacheStats().pendingEdits < 100);
+      assert.throws(() => statement.startIndex, /Stale node/);
+      assert.equal(tree.rootNode.firstChild.startIndex, 100);
+    });
+  });
+
   describe(".child", () => {
     it("returns the child at the given index", () => {
       parser.setLanguage(JSON);
@@ -589,6 +701,17 @@ describe("Node", () => {
         [4, 12]
       );
     })
+
+    it('finds error nodes and gives the same results for a repeated type list', () => {
+      const tree = parser.parse('a = {b: 1}; @;');
+      for (let i = 0; i < 2; i++) {
+        assert.deepEqual(
+          tree.rootNode.descendantsOfType(['ERROR', 'property_identifier', 'missing_type']).map(node => node.type),
+          ['property_identifier', 'ERROR']
+        );
+        assert.equal(tree.rootNode.descendantsOfType([]).length, 0);
+      }
+    })
   });
 
   describe('.closest(type)', () => {
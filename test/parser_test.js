@@ -106,6 +106,73 @@ describe("Parser", () => {
         ]);
       });
     });
+
+    it("parses a copy of byte arrays that the callback could modify", () => {
+      const buffer = Buffer.from("let a = 1;", "utf8");
+      const chunk = Buffer.from("b;", "utf8");
+      parser.setLogger(() => {
+        buffer.fill(" ");
+        chunk.fill(" ");
+      });
+      const tree = parser.parse(buffer, null, { encoding: "utf8" });
+      assert.equal(tree.rootNode.toString(), "(program (lexical_declaration (variable_declarator name: (identifier) value: (number))))");
+      const chunkedTree = parser.parse([chunk], null, { encoding: "utf8" });
+      assert.equal(chunkedTree.rootNode.toString(), "(program (expression_statement (identifier)))");
+    });
+  });
+
+  describe(".setLogger with a LogBuffer", () => {
+    it("records filtered messages natively", () => {
+      const logBuffer = new Parser.LogBuffer(64 * 1024, { types: ["parse"], prefixes: ["shift", "reduce"] });
+      parser.setLanguage(JavaScript);
+      parser.setLogger(logBuffer);
+      assert.equal(parser.getLogger(), logBuffer);
+
+      parser.parse("a + b + c");
+      const messages = logBuffer.drainMessages();
+      assert.ok(messages.length > 0);
+      assert.ok(messages.every(({ type, message }) => type === "parse" && /^(shift|reduce)/.test(message)));
+      assert.equal(logBuffer.getStats().records, 0);
+      assert.equal(logBuffer.drain().length, 0);
+
+      parser.setLogger(null);
+      parser.parse("a + b + c");
+      assert.equal(logBuffer.getStats().records, 0);
+    });
+
+    it("drops the oldest records when it's full", () => {
+      const logBuffer = new Parser.LogBuffer(256);
+      parser.setLanguage(JavaScript);
+      parser.setLogger(logBuffer);
+      parser.parse("let x = [1, 2, 3].map(y => y * 2);");
+
+      const stats = logBuffer.getStats();
+      assert.ok(stats.dropped > 0);
+      assert.ok(stats.bytes <= 256);
+      const buffer = logBuffer.drain();
+      assert.equal(buffer.length, stats.bytes);
+      let offset = 0;
+      while (offset < buffer.length) {
+        offset += 4 + buffer.readUInt16LE(offset + 2);
+      }
+      assert.equal(offset, buffer.length);
+    });
+
+    it("rejects capacities that aren't whole numbers of bytes in range", () => {
+      for (const capacity of [-1, 0, 3, 1.5, NaN, Infinity, 2 ** 32]) {
+        assert.throws(() => new Parser.LogBuffer(capacity), RangeError);
+      }
+      assert.throws(() => new Parser.LogBuffer("256"), TypeError);
+      assert.equal(new Parser.LogBuffer(4).getStats().capacity, 4);
+    });
+
+    it("stays attached during background parses", async () => {
+      const logBuffer = new Parser.LogBuffer();
+      parser.setLanguage(JavaScript);
+      parser.setLogger(logBuffer);
+      await parser.parseAsync("a + b");
+      assert.ok(logBuffer.getStats().records > 0);
+    });
   });
 
   describe(".printDotGraphs", () => {
@@ -199,6 +266,105 @@ describe("Parser", () => {
       assert.equal(tree.rootNode.firstChild.firstChild.namedChildCount, repeatCount);
     });
 
+    it("reports string indices for ASCII and non-ASCII strings alike", () => {
+      for (const sourceCode of ["x = 'abc';", "x = 'äbc';", "x = '😀';"]) {
+        const tree = parser.parse(sourceCode);
+        const string = tree.rootNode.descendantsOfType("string")[0];
+        assert.equal(string.startIndex, 4);
+        assert.equal(string.endIndex, sourceCode.length - 1);
+        assert.deepEqual(string.endPosition, { row: 0, column: sourceCode.length - 1 });
+        assert.equal(string.text, sourceCode.slice(4, -1));
+      }
+    });
+
+    it("reparses when an edit introduces non-ASCII text", () => {
+      const tree = parser.parse("x = 'abc';");
+      tree.edit({
+        startIndex: 5,
+        oldEndIndex: 6,
+        newEndIndex: 6,
+        startPosition: { row: 0, column: 5 },
+        oldEndPosition: { row: 0, column: 6 },
+        newEndPosition: { row: 0, column: 6 },
+      });
+      const newTree = parser.parse("x = 'äbc';", tree);
+      const string = newTree.rootNode.descendantsOfType("string")[0];
+      assert.equal(string.endIndex, 9);
+      assert.equal(string.text, "'äbc'");
+
+      // The ASCII tree was parsed as UTF-8 and the new one as UTF-16, so the
+      // whole new tree is reported as changed.
+      assert.deepEqual(tree.getChangedRanges(newTree).map(range => [range.startIndex, range.endIndex]), [[0, 10]]);
+    });
+
+    describe("when given an array of chunks", () => {
+      it("parses the chunks as one document", () => {
+        const chunks = ["let x = 'ä", "bc';\n", "", "console.log(", "x);"];
+        const tree = parser.parse(chunks);
+        assert.equal(
+          tree.rootNode.toString(),
+          "(program (lexical_declaration (variable_declarator name: (identifier) value: (string (string_fragment)))) " +
+          "(expression_statement (call_expression function: (member_expression object: (identifier) property: (property_identifier)) arguments: (arguments (identifier)))))"
+        );
+        assert.equal(tree.rootNode.text, chunks.join(""));
+        assert.equal(tree.rootNode.firstChild.firstNamedChild.childForFieldName("value").text, "'äbc'");
+      });
+
+      it("mixes strings and UTF-8 buffers", () => {
+        const chunks = [Buffer.from("let x = 'ä"), "bc';", new Uint8Array(Buffer.from(" f(x);"))];
+        const tree = parser.parse(chunks, null, { encoding: "utf8" });
+        assert.equal(tree.rootNode.lastChild.startIndex, 16);
+        assert.equal(tree.rootNode.lastChild.text, "f(x);");
+        assert.equal(tree.rootNode.firstChild.text, "let x = 'äbc';");
+      });
+
+      it("reads characters that are split between buffers", () => {
+        const utf8 = Buffer.from("let x = 'é';");
+        const utf8Tree = parser.parse([utf8.subarray(0, 10), utf8.subarray(10)], null, { encoding: "utf8" });
+        assert.equal(utf8Tree.rootNode.hasError, false);
+        assert.equal(utf8Tree.rootNode.descendantsOfType("string")[0].text, "'é'");
+
+        // Split the surrogate pair between its halves, and one half between its bytes.
+        const utf16 = Buffer.from("let x = '😀';", "utf16le");
+        const utf16Tree = parser.parse([utf16.subarray(0, 19), utf16.subarray(19, 20), utf16.subarray(20)]);
+        assert.equal(utf16Tree.rootNode.hasError, false);
+        assert.equal(utf16Tree.rootNode.descendantsOfType("string")[0].text, "'😀'");
+      });
+    });
+
+    describe("when given a Buffer with the `utf8` encoding", () => {
+      it("reports indices and columns in UTF-8 bytes", () => {
+        const input = Buffer.from("x = 'äbc';\ny = 1;", "utf8");
+        const tree = parser.parse(input, null, { encoding: "utf8" });
+        const string = tree.rootNode.descendantsOfType("string")[0];
+        assert.equal(string.startIndex, 4);
+        assert.equal(string.endIndex, 10);
+        assert.deepEqual(string.endPosition, { row: 0, column: 10 });
+        assert.equal(string.text, "'äbc'");
+        assert.equal(tree.rootNode.lastChild.startIndex, 12);
+      });
+
+      it("reuses an old tree parsed from UTF-8 bytes", () => {
+        const tree = parser.parse(Buffer.from("x = 'äbc';"), null, { encoding: "utf8" });
+        tree.edit({
+          startIndex: 11,
+          oldEndIndex: 11,
+          newEndIndex: 17,
+          startPosition: { row: 0, column: 11 },
+          oldEndPosition: { row: 0, column: 11 },
+          newEndPosition: { row: 0, column: 17 },
+        });
+        const newTree = parser.parse(new Uint8Array(Buffer.from("x = 'äbc';y = 1;")), tree, { encoding: "utf8" });
+        assert.equal(newTree.rootNode.lastChild.text, "y = 1;");
+        assert.equal(newTree.rootNode.lastChild.startIndex, 11);
+      });
+
+      it("rejects unknown encodings", () => {
+        // @ts-ignore
+        assert.throws(() => parser.parse(Buffer.from("x"), null, { encoding: "latin1" }), /Encoding/);
+      });
+    });
+
     describe('when the `includedRanges` option is given', () => {
       it('parses the text within those ranges of the string', () => {
         const sourceCode = "<% foo() %> <% bar %>";
@@ -284,6 +450,45 @@ describe("Parser", () => {
       });
     });
 
+    describe('parsing with a cancellation flag or deadline', () => {
+      it('stops without calling back into JavaScript', () => {
+        parser.setLanguage(JSON);
+        const input = "[" + "0,".repeat(10000) + "0]";
+
+        const cancellationFlag = new Int32Array(new SharedArrayBuffer(4));
+        Atomics.store(cancellationFlag, 0, 1);
+        assert.equal(parser.parse(input, null, { cancellationFlag }), null);
+        parser.reset();
+
+        assert.equal(parser.parse(input, null, { deadline: process.hrtime.bigint() }), null);
+        parser.reset();
+
+        const controller = new AbortController();
+        controller.abort();
+        assert.equal(parser.parse(input, null, { signal: controller.signal }), null);
+        parser.reset();
+
+        const deadline = process.hrtime.bigint() + 60_000_000_000n;
+        Atomics.store(cancellationFlag, 0, 0);
+        const tree = parser.parse(input, null, { cancellationFlag, deadline });
+        assert.equal(tree.rootNode.firstChild.namedChildCount, 10001);
+      });
+
+      it('stops a background parse when the signal is aborted', async () => {
+        parser.setLanguage(JSON);
+        const controller = new AbortController();
+        controller.abort();
+        const tree = await parser.parseAsync("[" + "0,".repeat(10000) + "0]", null, { signal: controller.signal });
+        assert.equal(tree, null);
+        parser.reset();
+      });
+
+      it('rejects a flag that is not an Int32Array', () => {
+        // @ts-ignore
+        assert.throws(() => parser.parse("[]", null, { cancellationFlag: [1] }), /Int32Array/);
+      });
+    });
+
     describe('parsing with a timeout and reset', () => {
       it('stops after a certain number of microseconds and resets the parser', () => {
         parser.setLanguage(JSON);
@@ -686,4 +891,298 @@ describe("Parser", () => {
       });
     });
   });
+
+  describe(".parseAsync", () => {
+    beforeEach(() => {
+      parser.setLanguage(JavaScript);
+    });
+
+    it("parses a string on a background thread", async () => {
+      const tree = await parser.parseAsync("a + b");
+      assert.equal(
+        tree.rootNode.toString(),
+        "(program (expression_statement (binary_expression left: (identifier) right: (identifier))))"
+      );
+      assert.equal(tree.rootNode.firstChild.firstChild.lastChild.text, "b");
+    });
+
+    it("parses a buffer of UTF-16LE text", async () => {
+      const tree = await parser.parseAsync(Buffer.from("let x = 'ö';", "utf16le"));
+      assert.equal(tree.rootNode.firstChild.type, "lexical_declaration");
+      assert.equal(tree.rootNode.endIndex, 12);
+      assert.equal(tree.rootNode.firstChild.firstNamedChild.childForFieldName("value").text, "'ö'");
+    });
+
+    it("reuses the given old tree", async () => {
+      const tree = await parser.parseAsync("abc + cde");
+      tree.edit({
+        startIndex: 3,
+        oldEndIndex: 3,
+        newEndIndex: 7,
+        startPosition: { row: 0, column: 3 },
+        oldEndPosition: { row: 0, column: 3 },
+        newEndPosition: { row: 0, column: 7 },
+      });
+      const newTree = await parser.parseAsync("abc * 1 + cde", tree);
+      assert.equal(
+        newTree.rootNode.toString(),
+        "(program (expression_statement (binary_expression " +
+        "left: (binary_expression left: (identifier) right: (number)) right: (identifier))))"
+      );
+    });
+
+    it("marks the parser as busy until the parse completes", async () => {
+      const pending = parser.parseAsync("[" + "0,".repeat(10000) + "]");
+      assert.throws(() => parser.parse("a"), /busy/);
+      assert.throws(() => parser.setLanguage(JSON), /busy/);
+      await assert.rejects(parser.parseAsync("b"), /busy/);
+
+      const tree = await pending;
+      assert.equal(tree.rootNode.firstChild.firstChild.namedChildCount, 10000);
+      assert.equal(parser.parse("a").rootNode.type, "program");
+    });
+
+    it("rejects input that is not a string or a buffer", async () => {
+      // @ts-ignore
+      await assert.rejects(parser.parseAsync(() => "a"), /Input.*string.*Buffer/);
+    });
+  });
+
+  describe(".parseSlice", () => {
+    beforeEach(() => {
+      parser.setLanguage(JavaScript);
+    });
+
+    it("resumes a parse across slices until it finishes", () => {
+      const input = "[" + "0,".repeat(20000) + "]";
+      let slices = 0;
+      let tree;
+      do {
+        tree = parser.parseSlice(input, null, { budgetMicros: 100 });
+        slices++;
+      } while (tree === Parser.PENDING);
+      assert.ok(slices > 1);
+      assert.equal(tree.rootNode.firstChild.firstChild.namedChildCount, 20000);
+      assert.equal(tree.rootNode.firstChild.firstChild.firstNamedChild.text, "0");
+    });
+
+    it("starts over when given a different input or another parse intervenes", () => {
+      const input = "[" + "0,".repeat(20000) + "]";
+      assert.equal(parser.parseSlice(input, null, { budgetMicros: 0 }), Parser.PENDING);
+      assert.equal(parser.parse("a").rootNode.firstChild.type, "expression_statement");
+      assert.equal(parser.parseSlice("b", null, { budgetMicros: 1e6 }).rootNode.text, "b");
+    });
+  });
+
+  describe(".parseFile", () => {
+    const fs = require("fs");
+    const tmp = require("tmp");
+    const sourceCode = "let x = 'äbc';\nf(x);";
+    /** @type {string} */
+    let path;
+
+    beforeEach(() => {
+      parser.setLanguage(JavaScript);
+      path = tmp.fileSync({ postfix: ".js" }).name;
+      fs.writeFileSync(path, sourceCode);
+    });
+
+    it("parses a UTF-8 file with byte offsets", () => {
+      const tree = parser.parseFile(path);
+      assert.equal(tree.rootNode.lastChild.startIndex, 16);
+      assert.equal(tree.rootNode.lastChild.text, "f(x);");
+      assert.equal(tree.rootNode.text, sourceCode);
+    });
+
+    it("keeps the contents it parsed when the file changes", () => {
+      const tree = parser.parseFile(path);
+      fs.writeFileSync(path, "");
+      assert.equal(tree._source().toString(), sourceCode);
+      assert.equal(tree.rootNode.firstChild.text, "let x = 'äbc';");
+    });
+
+    it("maps the file when asked to", () => {
+      const tree = parser.parseFile(path, null, { mmap: true });
+      assert.equal(tree._source().toString(), sourceCode);
+      assert.equal(tree.rootNode.firstChild.text, "let x = 'äbc';");
+    });
+
+    it("parses a file on a background thread", async () => {
+      const tree = await parser.parseFileAsync(path);
+      assert.equal(tree.rootNode.firstChild.firstNamedChild.childForFieldName("value").text, "'äbc'");
+    });
+
+    it("throws when the file can't be read", async () => {
+      assert.throws(() => parser.parseFile(path + ".missing"), /Failed to read/);
+      await assert.rejects(parser.parseFileAsync(path + ".missing"), /Failed to read/);
+    });
+  });
+
+  describe(".parseMany", () => {
+    it("parses every input on a pool of threads", async () => {
+      const inputs = [];
+      for (let i = 0; i < 50; i++) {
+        inputs.push(i % 2 ? `let x${i} = ${i};` : Buffer.from(`f(${i});`, "utf8"));
+      }
+      const trees = await Parser.parseMany(JavaScript, inputs, { concurrency: 4, encoding: "utf8" });
+      assert.equal(trees.length, inputs.length);
+      trees.forEach((tree, i) => {
+        assert.equal(tree.rootNode.firstChild.type, i % 2 ? "lexical_declaration" : "expression_statement");
+        assert.equal(tree.rootNode.text, inputs[i].toString());
+        assert.equal(tree.language, JavaScript);
+      });
+    });
+
+    it("rejects inputs that are not strings or buffers", async () => {
+      // @ts-ignore
+      await assert.rejects(Parser.parseMany(JavaScript, ["a", 1]), /Inputs.*string/);
+    });
+
+    it("runs overlapping batches on the same pool", async () => {
+      const batches = await Promise.all([
+        Parser.parseMany(JavaScript, ["a;", "b;", "c;"]),
+        Parser.parseMany(JavaScript, []),
+        Parser.parseMany(JavaScript, ["d;"], { concurrency: 1 }),
+      ]);
+      assert.deepEqual(batches.map(trees => trees.map(tree => tree.rootNode.text)), [["a;", "b;", "c;"], [], ["d;"]]);
+    });
+  });
+
+  describe(".stats", () => {
+    it("counts the cost of each parse and how much of the old tree was reused", () => {
+      parser.setLanguage(JavaScript);
+      const processParseCount = Parser.stats().parseCount;
+      assert.equal(parser.stats().lastParse, null);
+
+      const source = "let a = 1;\nlet b = 2;\nlet c = 3;\n";
+      const tree = parser.parse(source);
+      let stats = parser.stats();
+      assert.equal(stats.parseCount, 1);
+      assert.equal(stats.errorCount, 0);
+      assert.ok(stats.bytesRead >= Buffer.byteLength(source));
+      assert.ok(stats.readCount > 0);
+      assert.ok(stats.parseTimeMicros > 0);
+      assert.equal(stats.reuseRatio, null);
+      assert.equal(stats.lastParse.reuseRatio, null);
+
+      tree.edit({
+        startIndex: 19, oldEndIndex: 20, newEndIndex: 20,
+        startPosition: { row: 1, column: 8 },
+        oldEndPosition: { row: 1, column: 9 },
+        newEndPosition: { row: 1, column: 9 },
+      });
+      parser.parse("let a = 1;\nlet b = );\nlet c = 3;\n", tree);
+      stats = parser.stats();
+      assert.equal(stats.parseCount, 2);
+      assert.equal(stats.incrementalParseCount, 1);
+      assert.ok(stats.lastParse.errorCount > 0);
+      assert.ok(stats.lastParse.reuseRatio > 0 && stats.lastParse.reuseRatio < 1);
+      assert.equal(Parser.stats().parseCount, processParseCount + 2);
+    });
+
+    it("counts the calls to an input callback", () => {
+      parser.setLanguage(JavaScript);
+      let calls = 0;
+      parser.parse((index) => {
+        calls++;
+        return index < 3 ? "a;b"[index] : null;
+      });
+      assert.equal(parser.stats().lastParse.readCount, calls);
+    });
+  });
+});
+
+describe("ParseCache", () => {
+  it("returns a copy of the cached tree for text it has seen", () => {
+    const cache = new Parser.ParseCache();
+    const parser = new Parser().setLanguage(JavaScript);
+    assert.equal(parser.setCache(cache), parser);
+    assert.equal(parser.getCache(), cache);
+
+    const first = parser.parse("let x = 1;");
+    const second = parser.parse("let x = 1;");
+    assert.notEqual(first, second);
+    assert.equal(second.rootNode.toString(), first.rootNode.toString());
+    assert.equal(second.rootNode.text, "let x = 1;");
+
+    // ASCII strings are parsed as UTF-8, so only a different encoding or
+    // different included ranges make for a new entry.
+    parser.parse(Buffer.from("let x = 1;", "utf16le"), null, { encoding: "utf16le" });
+    parser.parse("let x = 1;", null, {
+      includedRanges: [{ startIndex: 0, endIndex: 5, startPosition: { row: 0, column: 0 }, endPosition: { row: 0, column: 5 } }],
+    });
+
+    const stats = cache.getStats();
+    assert.equal(stats.hits, 1);
+    assert.equal(stats.misses, 3);
+    assert.equal(stats.entries, 3);
+
+    parser.setCache(null);
+    assert.equal(parser.getCache(), null);
+  });
+
+  it("evicts the least recently used trees", () => {
+    const cache = new Parser.ParseCache(4096);
+    const parser = new Parser().setLanguage(JavaScript).setCache(cache);
+    for (let i = 0; i < 50; i++) {
+      parser.parse(`let x${i} = ${i};`);
+    }
+    const stats = cache.getStats();
+    assert(stats.evictions > 0);
+    assert(stats.bytes <= 4096);
+    assert.equal(cache.clear().getStats().entries, 0);
+  });
+
+  it("rejects a maximum size that isn't a non-negative integer", () => {
+    for (const maxBytes of [-1, 1.5, NaN, Infinity]) {
+      assert.throws(() => new Parser.ParseCache(maxBytes), RangeError);
+    }
+    assert.throws(() => new Parser.ParseCache("4096"), TypeError);
+    assert.equal(new Parser.ParseCache(0).getStats().maxBytes, 0);
+  });
+});
+
+describe("ParseScheduler", () => {
+  it("parses documents on its threads", async () => {
+    const scheduler = new Parser.ParseScheduler(2);
+    const [a, b] = await Promise.all([
+      scheduler.parse(JavaScript, "let a = 1;", { key: "a.js" }),
+      scheduler.parse(JavaScript, Buffer.from("b();", "utf8"), { priority: "background", encoding: "utf8" }),
+    ]);
+    assert.equal(a.rootNode.text, "let a = 1;");
+    assert.equal(a.language, JavaScript);
+    assert.equal(b.rootNode.firstChild.type, "expression_statement");
+
+    const metrics = scheduler.getMetrics();
+    assert.equal(metrics.completed, 2);
+    assert.equal(metrics.interactive.waitMicros.count, 1);
+    assert.equal(metrics.background.waitMicros.count, 1);
+    scheduler.close();
+  });
+
+  it("gives every caller the newest tree for a key", async () => {
+    const scheduler = new Parser.ParseScheduler(1);
+    const versions = [];
+    for (let i = 0; i < 20; i++) {
+      versions.push(scheduler.parse(JavaScript, `let x = ${i};`.repeat(1000), { key: "doc.js" }));
+    }
+    const trees = await Promise.all(versions);
+    const last = trees[trees.length - 1];
+    assert.equal(last.rootNode.text, "let x = 19;".repeat(1000));
+    assert(scheduler.getMetrics().coalesced > 0);
+    assert.equal(trees[trees.length - 2], last);
+    scheduler.close();
+  });
+
+  it("rejects queued jobs when closed", async () => {
+    const scheduler = new Parser.ParseScheduler(1);
+    const inputs = [];
+    for (let i = 0; i < 10; i++) {
+      inputs.push(scheduler.parse(JavaScript, "let x = 1;".repeat(10000), { priority: "background" }));
+    }
+    scheduler.close();
+    const results = await Promise.allSettled(inputs);
+    assert(results.some((result) => result.status === "rejected" && /closed/.test(result.reason.message)));
+    await assert.rejects(scheduler.parse(JavaScript, "x"), /closed/);
+  });
 });
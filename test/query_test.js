@@ -126,6 +126,17 @@ describe("Query", () => {
       ]);
     });
 
+    it("stops when the cancellation flag is set", () => {
+      const tree = parser.parse("[" + "a,".repeat(10000) + "a]");
+      const query = new Query(JavaScript, "(identifier) @element");
+      const cancellationFlag = new Int32Array(1);
+      assert.equal(query.matches(tree.rootNode, { cancellationFlag }).length, 10001);
+
+      cancellationFlag[0] = 1;
+      assert.ok(query.matches(tree.rootNode, { cancellationFlag }).length < 10001);
+      assert.ok(query.captures(tree.rootNode, { deadline: process.hrtime.bigint() }).length < 10001);
+    });
+
     it("finds optional nodes even when using #eq? predicate", () => {
       const tree = parser.parse(`
         { one: true };
@@ -81,6 +81,211 @@ describe("Tree", () => {
         "(program (expression_statement (binary_expression left: (binary_expression left: (identifier) right: (identifier)) right: (identifier))))"
       );
     });
+
+    it('drops logged edits once every live node has applied them', () => {
+      const tree = parser.parse('a;');
+      const root = tree.rootNode;
+      const statement = root.firstChild;
+      const insertion = {
+        startIndex: 0, oldEndIndex: 0, newEndIndex: 1,
+        startPosition: { row: 0, column: 0 },
+        oldEndPosition: { row: 0, column: 0 },
+        newEndPosition: { row: 0, column: 1 },
+      };
+
+      // The nodes haven't been used since the first edit, so every edit is kept.
+      for (let i = 0; i < 100; i++) tree.edit(insertion);
+      assert.equal(tree.getNodeCacheStats().pendingEdits, 100);
+      assert.equal(statement.startIndex, 100);
+      assert.equal(root.endIndex, 102);
+
+      for (let i = 0; i < 100; i++) tree.edit(insertion);
+      assert.ok(tree.getNodeCacheStats().pendingEdits < 200);
+      assert.equal(statement.startIndex, 200);
+      assert.equal(root.endIndex, 202);
+    });
+  });
+
+  describe('.editMany', () => {
+    it('applies every edit to the tree and to existing nodes', () => {
+      let input = 'abc + cde';
+      let tree = parser.parse(input);
+      const sumNode = tree.rootNode.firstChild.firstChild;
+      const variableNode1 = sumNode.firstChild;
+      const variableNode2 = sumNode.lastChild;
+
+      const edits = [];
+      let edit;
+      [input, edit] = spliceInput(input, input.indexOf('bc'), 0, ' * ');
+      edits.push(edit);
+      [input, edit] = spliceInput(input, input.indexOf('cde'), 0, 'x + ');
+      edits.push(edit);
+      assert.equal(input, 'a * bc + x + cde');
+
+      assert.equal(tree.editMany(edits), tree);
+      assert.deepEqual([variableNode1.startIndex, variableNode1.endIndex], [0, 6]);
+      assert.deepEqual([variableNode2.startIndex, variableNode2.endIndex], [13, 16]);
+      assert.deepEqual(variableNode2.startPosition, { row: 0, column: 13 });
+
+      tree = parser.parse(input, tree);
+      assert.equal(tree.rootNode.text, input);
+      assert.equal(tree.rootNode.hasError, false);
+    });
+
+    it('rejects edits with missing fields', () => {
+      const tree = parser.parse('abc');
+      // @ts-ignore
+      assert.throws(() => tree.editMany([{ startIndex: 0 }]), TypeError);
+    });
+  });
+
+  describe('.editFromText', () => {
+    it('computes and applies the edit between two texts', () => {
+      const oldText = 'let x = αβ;\nconsole.log(x);';
+      const newText = 'let x = αβ;\nconsole.log(yy);';
+      const tree = parser.parse(oldText);
+      const argument = tree.rootNode.child(1).firstChild.lastChild;
+
+      const edit = tree.editFromText(oldText, newText);
+      assert.deepEqual(edit, {
+        startIndex: 24, oldEndIndex: 25, newEndIndex: 26,
+        startPosition: { row: 1, column: 12 },
+        oldEndPosition: { row: 1, column: 13 },
+        newEndPosition: { row: 1, column: 14 },
+      });
+      assert.equal(argument.endIndex, 27);
+
+      const newTree = parser.parse(newText, tree);
+      assert.equal(newTree.rootNode.child(1).firstChild.lastChild.text, '(yy)');
+    });
+
+    it('computes edits in bytes for UTF-8 text', () => {
+      const edit = Parser.Tree.computeEdit(Buffer.from('f(é)'), Buffer.from('f(è)'), 'utf8');
+      assert.equal(edit.startIndex, 2);
+      assert.equal(edit.oldEndIndex, 4);
+      assert.equal(edit.newEndIndex, 4);
+    });
+  });
+
+  describe('.copy()', () => {
+    it('returns an independent tree with the same nodes', () => {
+      const tree = parser.parse('a + b;');
+      const copy = tree.copy();
+      assert.notEqual(copy, tree);
+      assert.equal(copy.rootNode.toString(), tree.rootNode.toString());
+      assert.equal(copy.rootNode.child(0).text, 'a + b;');
+
+      copy.edit({
+        startIndex: 0, oldEndIndex: 0, newEndIndex: 1,
+        startPosition: { row: 0, column: 0 },
+        oldEndPosition: { row: 0, column: 0 },
+        newEndPosition: { row: 0, column: 1 },
+      });
+      assert.equal(copy.rootNode.hasChanges, true);
+      assert.equal(tree.rootNode.hasChanges, false);
+    });
+  });
+
+  describe('.toTransferable()', () => {
+    it('moves a tree to a worker thread without reparsing it', async () => {
+      const { Worker } = require('worker_threads');
+      const tree = parser.parse('let x = 1; console.log(x);');
+      const worker = new Worker(`
+        const { parentPort, workerData } = require('worker_threads');
+        const Parser = require(${JSON.stringify(require.resolve('../index.js'))});
+        const JavaScript = require(${JSON.stringify(require.resolve('tree-sitter-javascript'))});
+        const tree = Parser.Tree.fromTransferable(workerData, JavaScript);
+        parentPort.postMessage([tree.rootNode.toString(), tree.rootNode.child(1).text]);
+      `, { eval: true, workerData: tree.toTransferable() });
+      const [message] = await require('events').once(worker, 'message');
+      assert.deepEqual(message, [tree.rootNode.toString(), 'console.log(x);']);
+    });
+
+    it('can only be adopted once', () => {
+      const transferable = parser.parse('x').toTransferable();
+      assert.equal(Parser.Tree.fromTransferable(transferable, JavaScript).rootNode.text, 'x');
+      assert.throws(() => Parser.Tree.fromTransferable(transferable, JavaScript));
+    });
+
+    it('rejects a different language', () => {
+      const transferable = parser.parse('x').toTransferable();
+      assert.throws(() => Parser.Tree.fromTransferable(transferable, Rust));
+      assert.equal(Parser.Tree.fromTransferable(transferable, JavaScript).rootNode.type, 'program');
+    });
+
+    it('carries a retained source natively instead of cloning the input', () => {
+      const transferable = parser.parse('f(x);', null, { retainSource: true }).toTransferable();
+      assert.equal(transferable.input, undefined);
+      const tree = Parser.Tree.fromTransferable(transferable, JavaScript);
+      assert.equal(tree.rootNode.firstChild.text, 'f(x);');
+    });
+
+    it('frees handles that are still pending when their thread exits', async () => {
+      const { Worker } = require('worker_threads');
+      const worker = new Worker(`
+        const { parentPort } = require('worker_threads');
+        const Parser = require(${JSON.stringify(require.resolve('../index.js'))});
+        const JavaScript = require(${JSON.stringify(require.resolve('tree-sitter-javascript'))});
+        parentPort.postMessage(new Parser().setLanguage(JavaScript).parse('x').toTransferable());
+      `, { eval: true });
+      const [[transferable]] = await Promise.all([
+        require('events').once(worker, 'message'),
+        require('events').once(worker, 'exit'),
+      ]);
+      assert.throws(() => Parser.Tree.fromTransferable(transferable, JavaScript), /already been adopted/);
+    });
+  });
+
+  describe('.texts()', () => {
+    it('slices node texts from a retained source', async () => {
+      const source = 'let é = "ü"; f(é);';
+      for (const tree of [
+        parser.parse(source, null, { retainSource: true }),
+        parser.parse(Buffer.from(source, 'utf8'), null, { encoding: 'utf8', retainSource: true }),
+        parser.parse(['let é = ', '"ü"; f(é);'], null, { retainSource: true }),
+        await parser.parseAsync(source, null, { retainSource: true }),
+      ]) {
+        const identifiers = tree.rootNode.descendantsOfType('identifier');
+        assert.deepEqual(tree.texts(identifiers), ['é', 'f', 'é']);
+        assert.equal(tree.rootNode.firstChild.text, 'let é = "ü";');
+        assert.equal(tree.walk().nodeText, source);
+      }
+    });
+
+    it('falls back to each node\'s text without a retained source', () => {
+      const tree = parser.parse('a + b;');
+      assert.deepEqual(tree.texts(tree.rootNode.descendantsOfType('identifier')), ['a', 'b']);
+    });
+  });
+
+  describe('.bulkAttributes()', () => {
+    it('fills arrays with the attributes of many nodes', () => {
+      const tree = parser.parse('a;\n  b(;');
+      const nodes = tree.rootNode.descendantsOfType(['identifier', 'ERROR', 'expression_statement']);
+      const output = tree.bulkAttributes(nodes, {
+        typeId: new Uint32Array(nodes.length),
+        startIndex: new Uint32Array(nodes.length),
+        endRow: new Uint32Array(nodes.length),
+        endColumn: new Uint32Array(nodes.length),
+        flags: new Uint32Array(nodes.length),
+      });
+      assert.equal(output.startRow, undefined);
+      nodes.forEach((node, i) => {
+        assert.equal(output.typeId[i], node.typeId);
+        assert.equal(output.startIndex[i], node.startIndex);
+        assert.equal(output.endRow[i], node.endPosition.row);
+        assert.equal(output.endColumn[i], node.endPosition.column);
+        assert.equal(Boolean(output.flags[i] & Parser.Tree.NodeFlags.NAMED), node.isNamed);
+        assert.equal(Boolean(output.flags[i] & Parser.Tree.NodeFlags.HAS_ERROR), node.hasError);
+      });
+    });
+
+    it('rejects nodes from another tree and short outputs', () => {
+      const tree = parser.parse('a;');
+      const other = parser.parse('b;');
+      assert.throws(() => tree.bulkAttributes([other.rootNode], { typeId: new Uint32Array(1) }), TypeError);
+      assert.throws(() => tree.bulkAttributes([tree.rootNode], { typeId: new Uint32Array(0) }), RangeError);
+    });
   });
 
   describe('.getEditedRange()', () => {
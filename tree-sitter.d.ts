@@ -4,24 +4,106 @@ declare module "tree-sitter" {
     /**
      * Parse UTF8 text into a syntax tree.
      *
-     * @param input - The text to parse, either as a string or a custom input function
-     * that provides text chunks. If providing a function, it should return text chunks
-     * based on byte index and position.
+     * @param input - The text to parse, either as a string, as a Buffer or Uint8Array
+     * in the given `encoding`, as an array of such chunks (for example, the pieces of a
+     * piece table), or as a custom input function that provides text chunks.
+     * If providing a function, it should return text chunks based on byte index and position.
      *
      * @param oldTree - An optional previous syntax tree from the same document.
      * If provided and the document has changed, you must first edit this tree using
      * {@link Parser.Tree.edit} to match the new text.
      *
      * @param options - Optional parsing settings:
-     * - bufferSize: Size of internal parsing buffer
+     * - bufferSize: Size of internal parsing buffer, used when the input is a callback
      * - includedRanges: Array of ranges to parse within the input
      * - progressCallback: A callback that receives the current parse state
+     * - encoding: The encoding of Buffer input, either 'utf16le' (the default) or 'utf8'.
+     *   String chunks in an array are converted to this encoding.
      *
      * @returns A syntax tree representing the parsed text
      *
      * @throws May fail if no language has been set or parsing was halted.
      */
-    parse(input: string | Parser.Input, oldTree?: Parser.Tree | null, options?: Parser.Options): Parser.Tree;
+    parse(input: string | Uint8Array | (string | Uint8Array)[] | Parser.Input, oldTree?: Parser.Tree | null, options?: Parser.Options): Parser.Tree;
+
+    /**
+     * Parse text into a syntax tree on a background thread.
+     *
+     * The input is copied into native memory before this method returns, so
+     * the parse itself never calls back into JavaScript. While the returned
+     * promise is pending, the parser is busy: calling any other method on it
+     * throws.
+     *
+     * @param input - The text to parse, either as a string or as a Buffer or
+     * Uint8Array in the given `encoding`.
+     *
+     * @param oldTree - An optional previous syntax tree from the same document.
+     * If provided and the document has changed, you must first edit this tree using
+     * {@link Parser.Tree.edit} to match the new text.
+     *
+     * @param options - Optional parsing settings:
+     * - includedRanges: Array of ranges to parse within the input
+     * - encoding: The encoding of Buffer input, either 'utf16le' (the default) or 'utf8'
+     *
+     * @returns A promise for the syntax tree, or for null if parsing was halted.
+     */
+    parseAsync(input: string | Uint8Array, oldTree?: Parser.Tree | null, options?: Parser.AsyncOptions): Promise<Parser.Tree | null>;
+
+    /**
+     * Parse a file into a syntax tree, without reading it into a JavaScript
+     * string first. The file is memory-mapped where the platform supports it.
+     *
+     * @param path - The path of the file to parse
+     *
+     * @param oldTree - An optional previous syntax tree from the same document.
+     * If provided and the document has changed, you must first edit this tree using
+     * {@link Parser.Tree.edit} to match the new text.
+     *
+     * @param options - Optional parsing settings:
+     * - encoding: The encoding of the file, either 'utf8' (the default) or 'utf16le'
+     * - mmap: Whether to memory-map the file instead of reading it into
+     *   memory. Either way, the tree keeps the file's contents for `node.text`.
+     *   A mapped file must not be truncated while it's being parsed or while
+     *   the tree is alive, or reading it crashes the process.
+     *
+     * @returns A syntax tree representing the parsed text
+     *
+     * @throws If the file can't be read.
+     */
+    parseFile(path: string, oldTree?: Parser.Tree | null, options?: Parser.FileOptions): Parser.Tree;
+
+    /**
+     * Like {@link Parser.parseFile}, but reads and parses the file on a
+     * background thread. While the returned promise is pending, the parser is
+     * busy: calling any other method on it throws.
+     */
+    parseFileAsync(path: string, oldTree?: Parser.Tree | null, options?: Parser.FileOptions): Promise<Parser.Tree | null>;
+
+    /**
+     * Parse text for at most a fixed time budget, so that a large document can
+     * be parsed on the main thread in slices between other work.
+     *
+     * If the budget runs out, this returns {@link Parser.PENDING}, and the
+     * parser keeps its progress along with a native copy of the input. Calling
+     * it again with the same input continues where the last slice stopped.
+     * Any other input, or any other kind of parse, starts over.
+     *
+     * @param input - The text to parse, either as a string or as a Buffer or
+     * Uint8Array in the given `encoding`.
+     *
+     * @param oldTree - An optional previous syntax tree from the same document.
+     * It is only read when a new parse starts.
+     *
+     * @param options - Optional parsing settings:
+     * - budgetMicros: How long this slice may take, which defaults to 5000
+     * - encoding: The encoding of Buffer input, either 'utf16le' (the default) or 'utf8'
+     *
+     * @returns The syntax tree, or {@link Parser.PENDING} if the parse isn't done yet.
+     */
+    parseSlice(input: string | Uint8Array, oldTree?: Parser.Tree | null, options?: Parser.SliceOptions): Parser.Tree | typeof Parser.PENDING | null;
+
+    /** Returned by {@link Parser.parseSlice} when the parse isn't finished. */
+    static readonly PENDING: unique symbol;
 
     /**
      * Get the ranges of text that the parser will include when parsing.
@@ -61,6 +143,38 @@ declare module "tree-sitter" {
      */
     reset(): void;
 
+    /**
+     * Get the cache that the parser looks up trees in, if it has one
+     */
+    getCache(): Parser.ParseCache | null;
+
+    /**
+     * Set a cache for the parser to look up trees in before parsing.
+     *
+     * Strings, Buffers and files that have been parsed before with the same
+     * language, included ranges and encoding are not parsed again; a copy of
+     * the cached tree is returned instead. Parses with an old tree, a callback
+     * input or an array of chunks bypass the cache.
+     *
+     * @param cache - The cache, which can be shared between parsers, or null
+     * to stop caching
+     */
+    setCache(cache: Parser.ParseCache | null): this;
+
+    /**
+     * Get counters for every parse this parser has run, and for the most
+     * recent one. They're cheap enough to leave on: error nodes are counted
+     * only inside subtrees that contain errors, and subtree reuse is derived
+     * from the ranges that changed from the old tree.
+     */
+    stats(): Parser.ParserStats;
+
+    /**
+     * Get the same counters as {@link Parser.stats}, summed over every parser
+     * in the process, including the threads used by {@link Parser.parseMany}.
+     */
+    static stats(): Parser.ParseStats;
+
     /**
      * Get the parser's current language
      */
@@ -82,14 +196,15 @@ declare module "tree-sitter" {
      *
      * @returns The current logging callback
      */
-    getLogger(): Parser.Logger;
+    getLogger(): Parser.Logger | Parser.LogBuffer | null;
 
     /**
      * Set the logging callback that the parser should use during parsing.
      *
-     * @param logFunc - The logging callback to use, or null/false to disable logging
+     * @param logFunc - The logging callback to use, a {@link Parser.LogBuffer}
+     * to record messages natively, or null/false to disable logging
      */
-    setLogger(logFunc?: Parser.Logger | string | false | null): void;
+    setLogger(logFunc?: Parser.Logger | Parser.LogBuffer | string | false | null): void;
 
     /**
      * Set the destination to which the parser should write debugging graphs during parsing.
@@ -101,12 +216,38 @@ declare module "tree-sitter" {
      * @param fd - Optional file descriptor for the output
      */
     printDotGraphs(enabled?: boolean, fd?: number): void;
+
+    /**
+     * Parse many documents at once on a pool of native threads. The pool is
+     * shared by every call and by document layers, and stays alive between
+     * calls.
+     *
+     * Each input is copied into native memory before this method returns.
+     * Every thread uses its own parser, so no JavaScript runs until the whole
+     * batch has been parsed.
+     *
+     * @param language - The language to parse the inputs with
+     *
+     * @param inputs - The documents to parse, as strings or as Buffers or
+     * Uint8Arrays in the given `encoding`
+     *
+     * @param options - Optional parsing settings:
+     * - concurrency: The most threads to use at once, which defaults to the number of CPUs
+     * - encoding: The encoding of Buffer inputs, either 'utf16le' (the default) or 'utf8'
+     *
+     * @returns A promise for the syntax trees, in the same order as the inputs.
+     * It's rejected if the language's ABI version isn't supported.
+     */
+    static parseMany(language: Parser.Language, inputs: (string | Uint8Array)[], options?: Parser.ManyOptions): Promise<(Parser.Tree | null)[]>;
   }
 
   namespace Parser {
     /** Configuration options for parsing */
     export type Options = {
-      /** Size of the internal parsing buffer */
+      /**
+       * Size of the internal parsing buffer, used when the input is a callback.
+       * String input is copied into native memory in a single pass.
+       */
       bufferSize?: number;
 
       /** Array of ranges to include when parsing the input */
@@ -121,8 +262,187 @@ declare module "tree-sitter" {
        * @returns `true` to stop parsing or `false` to continue
        */
       progressCallback?: (index: number, hasError: boolean) => boolean;
+
+      /**
+       * The encoding of Buffer or Uint8Array input. With 'utf8', the resulting
+       * tree reports indices and columns in UTF-8 bytes rather than UTF-16
+       * code units.
+       */
+      encoding?: Encoding;
+
+      /**
+       * Whether the tree keeps a native copy of its text, so that node text
+       * is sliced from it without calling back into JavaScript. Text read
+       * from a callback input isn't retained.
+       */
+      retainSource?: boolean;
+    } & NodeOptions & CancellationOptions;
+
+    /** Configuration options for parsing on a background thread */
+    export type AsyncOptions = {
+      /** Array of ranges to include when parsing the input */
+      includedRanges?: Range[];
+
+      /** The encoding of Buffer or Uint8Array input */
+      encoding?: Encoding;
+
+      /** Whether the tree keeps the native copy of its text */
+      retainSource?: boolean;
+    } & NodeOptions & CancellationOptions;
+
+    /** Configuration options for parsing a file */
+    export type FileOptions = {
+      /** The encoding of the file, which defaults to 'utf8' */
+      encoding?: Encoding;
+
+      /**
+       * Whether to memory-map the file instead of reading it, which defaults
+       * to false. A mapped file must not be truncated while the tree is alive.
+       */
+      mmap?: boolean;
+    } & NodeOptions & CancellationOptions;
+
+    /** Options for the nodes of the resulting tree */
+    export type NodeOptions = {
+      /**
+       * Whether the tree's nodes are values, which skip the tree's node table.
+       * See {@link Tree.setValueNodes}.
+       */
+      valueNodes?: boolean;
+
+      /**
+       * Whether the tree's nodes carry their type id and position.
+       * See {@link Tree.setGeometryPrefetch}.
+       */
+      prefetchGeometry?: boolean;
+    };
+
+    /**
+     * Ways to halt a parse or query that are checked in native code, without
+     * calling into JavaScript. When one of them fires, parsing returns null,
+     * and a query returns the results found so far.
+     */
+    export type CancellationOptions = {
+      /**
+       * A signal that halts a background parse when aborted. A synchronous
+       * parse or query blocks the event loop, so for those, only a signal that
+       * was aborted beforehand has an effect.
+       */
+      signal?: AbortSignal;
+
+      /**
+       * A flag that halts the work once its first element is non-zero. Back it
+       * with a SharedArrayBuffer to set it from another thread.
+       */
+      cancellationFlag?: Int32Array;
+
+      /**
+       * An absolute deadline in nanoseconds, on the same clock as
+       * `process.hrtime.bigint()`.
+       */
+      deadline?: bigint | number;
+    };
+
+    /** Configuration options for time-sliced parsing */
+    export type SliceOptions = {
+      /** How long a single slice may take, in microseconds */
+      budgetMicros?: number;
+
+      /** The encoding of Buffer or Uint8Array input */
+      encoding?: Encoding;
+    };
+
+    /** Configuration options for parsing many documents at once */
+    export type ManyOptions = {
+      /** The most native threads to parse with at once */
+      concurrency?: number;
+
+      /** The encoding of Buffer or Uint8Array inputs */
+      encoding?: Encoding;
+    };
+
+    /** Running totals of parse costs */
+    export type ParseStats = {
+      parseCount: number;
+      parseTimeMicros: number;
+
+      /** The number of times the input was read, which for a callback input is the number of calls */
+      readCount: number;
+      bytesRead: number;
+
+      /** The number of ERROR and MISSING nodes in the resulting trees */
+      errorCount: number;
+      cacheHits: number;
+      incrementalParseCount: number;
+
+      /** The number of bytes of incrementally parsed trees that didn't change from the old tree */
+      reusedBytes: number;
+
+      /** The fraction of incrementally parsed text that didn't change, or null if there were no incremental parses */
+      reuseRatio: number | null;
+    };
+
+    /** The cost of a single parse */
+    export type ParseSample = {
+      parseTimeMicros: number;
+      readCount: number;
+      bytesRead: number;
+      errorCount: number;
+      cacheHit: boolean;
+
+      /** The fraction of the tree that didn't change from the old tree, or null if there was no old tree */
+      reuseRatio: number | null;
+    };
+
+    export type ParserStats = ParseStats & {
+      /** The most recent parse, or null if the parser hasn't parsed anything */
+      lastParse: ParseSample | null;
+    };
+
+    /** Configuration options for a job submitted to a {@link ParseScheduler} */
+    export type ScheduleOptions = {
+      /**
+       * Identifies the document being parsed. A job with the same key as a
+       * queued or running job supersedes it.
+       */
+      key?: string;
+
+      /** Interactive jobs are always started before background ones */
+      priority?: 'interactive' | 'background';
+
+      /** A previous syntax tree of the same document, for incremental parsing */
+      oldTree?: Tree | null;
+
+      /** The encoding of Buffer or Uint8Array input */
+      encoding?: Encoding;
     };
 
+    /** Queue statistics reported by {@link ParseScheduler#getMetrics} */
+    export type ScheduleMetrics = {
+      /** The number of jobs currently being parsed */
+      running: number;
+
+      /** The number of jobs that have finished or been cancelled */
+      completed: number;
+
+      /** The number of jobs that were superseded by a newer job with the same key */
+      coalesced: number;
+
+      interactive: QueueMetrics;
+      background: QueueMetrics;
+    };
+
+    export type QueueMetrics = {
+      /** The number of jobs waiting to start */
+      queued: number;
+
+      /** How long jobs waited before starting, in microseconds */
+      waitMicros: {count: number; mean: number; max: number; p50: number; p99: number};
+    };
+
+    /** The encoding of text given to the parser as bytes */
+    export type Encoding = 'utf8' | 'utf16le';
+
     /**
      * A position in a multi-line text document, in terms of rows and columns.
      * Both values are zero-based.
@@ -189,6 +509,56 @@ declare module "tree-sitter" {
       type: "parse" | "lex"
     ) => void;
 
+    /** Options for a {@link LogBuffer} */
+    export type LogBufferOptions = {
+      /** The types of message to record, which defaults to both */
+      types?: ("parse" | "lex")[];
+
+      /** If given, only messages that start with one of these prefixes are recorded */
+      prefixes?: string[];
+    };
+
+    /**
+     * A parser logger that records messages into a fixed-size native ring
+     * buffer, without calling into JavaScript. It's cheap enough to leave on in
+     * production, and stays attached during background parses. When the
+     * buffer is full, the oldest messages are dropped.
+     */
+    export class LogBuffer {
+      /**
+       * @param capacity - The size of the buffer in bytes, an integer from 4 to
+       *   4294967295, which defaults to 1 MiB
+       * @param options - Filters applied before a message is recorded
+       */
+      constructor(capacity?: number, options?: LogBufferOptions);
+
+      /**
+       * Remove every recorded message and return them, oldest first. Each
+       * record is a 4-byte header, holding the type (0 for parse, 1 for lex),
+       * a zero byte and the message length as a little-endian uint16,
+       * followed by the message in UTF-8.
+       */
+      drain(): Buffer;
+
+      /** Remove every recorded message and return them decoded, oldest first */
+      drainMessages(): { type: "parse" | "lex"; message: string }[];
+
+      getStats(): LogBufferStats;
+    }
+
+    export type LogBufferStats = {
+      /** The number of records in the buffer */
+      records: number;
+      bytes: number;
+      capacity: number;
+
+      /** The number of records written since the buffer was created */
+      written: number;
+
+      /** The number of records overwritten before they were drained */
+      dropped: number;
+    };
+
     /** A function that provides text content for parsing based on byte index and position */
     export interface Input {
       /**
@@ -700,6 +1070,53 @@ declare module "tree-sitter" {
       gotoDescendant(goalDescendantIndex: number): void;
     }
 
+    export type NodeCacheStats = {
+      /** The number of node slots in use, including those whose objects haven't been swept yet */
+      nodes: number;
+
+      /** The number of nodes whose objects can be looked up by id */
+      indexed: number;
+      maxIndexed: number | null;
+
+      /** The number of times slots of collected objects have been reclaimed */
+      sweeps: number;
+      evictions: number;
+
+      /** The number of edits kept for nodes that haven't been brought up to date yet */
+      pendingEdits: number;
+    };
+
+    /**
+     * Arrays for {@link Tree.bulkAttributes} to fill, one element per node.
+     * Only the attributes whose arrays are given are computed.
+     */
+    export type NodeAttributes = {
+      typeId?: Uint32Array;
+      startIndex?: Uint32Array;
+      endIndex?: Uint32Array;
+      startRow?: Uint32Array;
+      startColumn?: Uint32Array;
+      endRow?: Uint32Array;
+      endColumn?: Uint32Array;
+
+      /** A combination of {@link Tree.NodeFlags} */
+      flags?: Uint32Array;
+    };
+
+    /**
+     * A handle to a syntax tree that can be passed between worker threads.
+     */
+    export interface TransferableTree {
+      /** The id of the native copy of the tree */
+      handle: number;
+
+      /** The encoding of the tree's indices */
+      encoding: Encoding;
+
+      /** The text the tree was parsed from, if it was a string or a buffer */
+      input?: string | Uint8Array;
+    }
+
     /**
      * A tree that represents the syntactic structure of a source code file.
      */
@@ -729,6 +1146,90 @@ declare module "tree-sitter" {
        */
       edit(edit: Edit): Tree;
 
+      /**
+       * Apply several edits in order, in a single call into the native
+       * library. Nodes obtained before the edits are updated the next time
+       * they are used.
+       *
+       * @param edits - The edits to apply to the tree
+       * @returns The edited tree
+       */
+      editMany(edits: Edit[]): Tree;
+
+      /**
+       * Edit the syntax tree to match a new version of its source code, given
+       * the whole old and new text. The edit spans everything between the
+       * texts' common prefix and common suffix.
+       *
+       * @param oldText - The text the tree was parsed from, as a string or as bytes in the tree's encoding
+       * @param newText - The new text
+       * @returns The edit that was applied
+       */
+      editFromText(oldText: string | Uint8Array, newText: string | Uint8Array): Edit;
+
+      /**
+       * Compute the edit that turns one text into another, without applying it.
+       *
+       * @param encoding - The encoding of the texts' indices, either 'utf16le' (the default) or 'utf8'
+       */
+      static computeEdit(oldText: string | Uint8Array, newText: string | Uint8Array, encoding?: Encoding): Edit;
+
+      /**
+       * Create a copy of this tree. Trees are immutable and reference counted
+       * natively, so copying is cheap. The copy can be edited independently.
+       *
+       * @returns A new tree sharing this tree's nodes
+       */
+      copy(): Tree;
+
+      /**
+       * Create a handle that can be sent to a worker thread with
+       * `postMessage` and turned back into a tree there with
+       * {@link Tree.fromTransferable}, without reparsing. Each handle holds a
+       * native copy of the tree until it is adopted, and can only be adopted
+       * once. A handle that hasn't been adopted by the time the thread that
+       * created it exits is freed, and can no longer be adopted.
+       *
+       * @returns A structured-cloneable handle to a copy of this tree
+       */
+      toTransferable(): TransferableTree;
+
+      /**
+       * Adopt a tree that was sent from another thread.
+       *
+       * @param transferable - A handle created by {@link Tree.toTransferable}
+       * @param language - The tree's language, as loaded on this thread
+       */
+      static fromTransferable(transferable: TransferableTree, language: Language): Tree;
+
+      /** The bits of the `flags` filled in by {@link Tree.bulkAttributes} */
+      static readonly NodeFlags: {
+        readonly NAMED: number;
+        readonly MISSING: number;
+        readonly EXTRA: number;
+        readonly HAS_ERROR: number;
+        readonly ERROR: number;
+        readonly HAS_CHANGES: number;
+      };
+
+      /**
+       * Read attributes of many nodes of this tree in a single native call.
+       *
+       * @param nodes - The nodes to read
+       * @param output - The arrays to fill in
+       *
+       * @returns The output arrays
+       */
+      bulkAttributes<T extends NodeAttributes>(nodes: SyntaxNode[], output: T): T;
+
+      /**
+       * Get the text of many nodes of this tree. If the tree retains its
+       * source, the texts are sliced from it in a single native call.
+       *
+       * @param nodes - The nodes whose text to get
+       */
+      texts(nodes: SyntaxNode[]): string[];
+
       /**
        * Create a new TreeCursor starting from the root of the tree.
        *
@@ -772,6 +1273,46 @@ declare module "tree-sitter" {
        */
       getEditedRange(): Range;
 
+      /**
+       * Get the size of the native table of nodes that are held by
+       * JavaScript objects.
+       */
+      getNodeCacheStats(): NodeCacheStats;
+
+      /**
+       * Cap the number of nodes whose objects can be looked up again. Past the
+       * cap, the oldest nodes are evicted from the lookup: their objects keep
+       * working, but getting the same node again returns a new object. By
+       * default there is no cap, and a node is always the same object for as
+       * long as it is reachable.
+       *
+       * @param capacity - The maximum number of nodes to look up, or null for no cap
+       */
+      setNodeCacheCapacity(capacity: number | null): Tree;
+
+      /**
+       * Hand out nodes as values instead of through the node table. Value
+       * nodes cost nothing to create or collect, but getting the same node
+       * twice returns two different objects, so they can't be compared with
+       * `===`. Nodes created before the switch keep working. A value node
+       * isn't kept up to date through every later edit of the tree: once the
+       * tree has dropped the edits made since the node was created, using the
+       * node throws a "Stale node" error, and it has to be looked up again.
+       *
+       * @param enabled - Whether new nodes are values
+       */
+      setValueNodes(enabled: boolean): Tree;
+
+      /**
+       * Transfer the type id, indices and positions of new nodes along with
+       * the nodes themselves, so those getters don't call into native code.
+       * Once the tree is edited, the nodes created before the edit go back to
+       * computing them natively.
+       *
+       * @param enabled - Whether new nodes carry their geometry
+       */
+      setGeometryPrefetch(enabled: boolean): Tree;
+
       /**
        * Print a graph of the tree in the DOT language.
        * You may want to pipe this to a 'dot' process to generate SVG output.
@@ -856,7 +1397,7 @@ declare module "tree-sitter" {
        * @returns `true` to stop the query or `false` to continue
        */
       progressCallback?: (index: number) => boolean;
-    };
+    } & CancellationOptions;
 
     export class Query {
       /** The maximum number of in-progress matches for this cursor. */
@@ -974,6 +1515,146 @@ declare module "tree-sitter" {
       didExceedMatchLimit(): boolean;
     }
 
+    /**
+     * A text change, in the style of an editor's change event. The range is
+     * given by indices, or by positions, in the document's text as it is just
+     * before the change.
+     */
+    export type TextEdit = {
+      range: {startIndex: number; endIndex: number} | {startPosition: Point; endPosition: Point};
+      text: string;
+    };
+
+    /**
+     * A query that finds text written in another language, marked with an
+     * `@injection.content` capture. Text predicates in the query are not
+     * evaluated.
+     */
+    export type Injection = {
+      /** The language of the injected text */
+      language: Language;
+
+      /** A query in the parent language */
+      query: Query;
+
+      /** The language whose layers the query runs on, which defaults to the document's language */
+      parentLanguage?: Language;
+    };
+
+    /** The syntax tree of one range of injected text in a {@link Document} */
+    export type DocumentLayer = {
+      language: Language;
+
+      /** 1 for text injected into the document, 2 for text injected into that, and so on */
+      depth: number;
+
+      range: Range;
+      tree: Tree;
+    };
+
+    /**
+     * A document whose text and latest syntax tree are kept in native memory.
+     * Applying edits updates the text, edits the tree, and reparses it in a
+     * single call.
+     *
+     * A document with injections also parses each range of injected text as
+     * a separate layer. Layers are parsed in parallel on native threads, and
+     * after an edit, only the layers whose text changed are reparsed.
+     */
+    export class Document {
+      /**
+       * @param language - The language to parse the document with
+       * @param text - The initial text, as a string or as bytes in the given encoding
+       * @param encoding - The encoding the text is stored in, either 'utf16le' (the default) or 'utf8'
+       * @param injections - Queries that find text in other languages
+       */
+      constructor(language: Language, text: string | Uint8Array, encoding?: Encoding, injections?: Injection[]);
+
+      /** Get the trees of the document's injected layers */
+      getLayers(): DocumentLayer[];
+
+      /**
+       * The syntax tree of the current text. It keeps a snapshot of the text
+       * it was parsed from, so its nodes' text doesn't change after later edits.
+       */
+      readonly tree: Tree;
+
+      /** Get the document's current text */
+      getText(): string;
+
+      getLanguage(): Language;
+
+      getEncoding(): Encoding;
+
+      /**
+       * Apply edits in order, each one relative to the text produced by the
+       * ones before it, and reparse the document.
+       *
+       * If any edit is invalid, none of them are applied.
+       *
+       * @returns The new syntax tree
+       */
+      applyTextEdits(edits: TextEdit[]): Tree;
+    }
+
+    /**
+     * Syntax trees keyed by a hash of their source text, for use with
+     * {@link Parser#setCache}. Trees are evicted in least-recently-used order
+     * once their approximate size exceeds the budget.
+     */
+    export class ParseCache {
+      /**
+       * @param maxBytes - The approximate memory budget, a non-negative integer
+       *   number of bytes, which defaults to 64 MiB
+       */
+      constructor(maxBytes?: number);
+
+      /** Get the number of hits, misses and evictions, and the cache's current size */
+      getStats(): ParseCacheStats;
+
+      /** Remove every tree from the cache */
+      clear(): this;
+    }
+
+    export type ParseCacheStats = {
+      hits: number;
+      misses: number;
+      evictions: number;
+      entries: number;
+      bytes: number;
+      maxBytes: number;
+    };
+
+    /**
+     * A fixed pool of native threads that parse documents in priority order.
+     * Submitting a new version of a document while an older one is still
+     * queued or running cancels the older job, and every caller waiting on
+     * it receives the newer tree.
+     */
+    export class ParseScheduler {
+      /**
+       * @param threads - The number of threads, which defaults to the number of CPUs
+       */
+      constructor(threads?: number);
+
+      /**
+       * Parse the given text on one of the scheduler's threads.
+       *
+       * @returns A promise for the syntax tree, or for `null` if the job was
+       * cancelled by {@link close}
+       */
+      parse(language: Language, input: string | Uint8Array, options?: ScheduleOptions): Promise<Tree | null>;
+
+      /** Get the scheduler's queue lengths and wait times */
+      getMetrics(): ScheduleMetrics;
+
+      /**
+       * Stop the scheduler's threads. Jobs that haven't started are rejected,
+       * and running jobs resolve to `null`.
+       */
+      close(): void;
+    }
+
     export class LookaheadIterator {
       /** The current symbol of the lookahead iterator. */
       readonly currentTypeId: number;